@@ -1,25 +1,152 @@
+// Enable MAP_ANONYMOUS for arrayify_map_file()
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
 #include "arrayify.h"
 #include <stdlib.h>
 #include <string.h>
+#include <stdint.h>    // for uint64_t
 #include <assert.h>
 
 #include <stdio.h>
 
+// Define ARRAYIFY_NO_SIMD to compare with the byte-at-a-time scan.
+// The nibble lookup needs SSSE3 (-mssse3) or AVX2 (-mavx2).
+#ifndef ARRAYIFY_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#define ARRAYIFY_SIMD_WIDTH 32
+#elif defined(__SSSE3__)
+#include <tmmintrin.h>
+#define ARRAYIFY_SIMD_WIDTH 16
+#endif
+#endif
+
 /*
  * Includes supporting arrayify_file()
  */
 #include <fcntl.h>     // for open(), stat()
 #include <sys/stat.h>  // for open(), stat()
-#include <unistd.h>   // for read()
+#include <sys/mman.h>  // for mmap()
+#include <pthread.h>   // for arrayify_string_parallel()
+#include <unistd.h>   // for read(), sysconf()
+#include <limits.h>   // for INT_MAX
 #include <errno.h>
 
 // IFS value used to split strings.  arrayify_prep_ifs() must
 // be called to ensure this variable has at least a default value.
 const char *arrayify_ifs = NULL;
 
+// Set to treat quotes like the shell does, see arrayify_set_quotes()
+int arrayify_quotes = 0;
+
+char arrayify_escape_chars[] = {
+   '\n',
+   '\t'
+};
+
+const char escapes[] = "nt";
+
+/*
+ * The context compiles IFS into bit maps of the 256 byte values,
+ * so testing a character is a lookup rather than a search of the
+ * IFS string.  *special* adds the backslash to the IFS characters,
+ * for finding the end of a run of characters that are copied
+ * unchanged, and, if *quotes* is set, the quote characters and '$'.
+ *
+ * With SIMD, each distinct high nibble of the special characters is
+ * assigned a bit, and *lo_nibbles[n]* collects the bits of the high
+ * nibbles that pair with low nibble *n*, so a byte is a candidate
+ * if lo_nibbles[low] & hi_nibbles[high] is non-zero.  With more
+ * than eight high nibbles, some share a bit, and the candidates
+ * are confirmed with the bit map.
+ *
+ * *escapes* maps each character following a backslash to the
+ * character it makes, from *arrayify_escape_chars* when compiled.
+ */
+
+// Context of the functions without _r, see arrayify_prep_ifs()
+static ARRAYIFY_CONTEXT arrayify_context;
+
+static inline int arrayify_map_test(const uint64_t *map, int chr)
+{
+   unsigned char uchr = (unsigned char)chr;
+   return (map[uchr >> 6] >> (uchr & 63)) & 1;
+}
+
+static inline int arrayify_ctx_is_ifs(const ARRAYIFY_CONTEXT *ctx, int chr)
+{
+   return arrayify_map_test(ctx->map, chr);
+}
+
+static inline char arrayify_ctx_escape(const ARRAYIFY_CONTEXT *ctx, char chr)
+{
+   return ctx->escapes[(unsigned char)chr];
+}
+
+void arrayify_context_init(ARRAYIFY_CONTEXT *ctx, const char *ifs, int quotes)
+{
+   if (ifs == NULL)
+      ifs = " \t\n";
+
+   memset(ctx, 0, sizeof(ARRAYIFY_CONTEXT));
+   ctx->ifs = ifs;
+   ctx->quotes = quotes;
+
+   for (const char *ptr = ifs; *ptr; ++ptr)
+   {
+      unsigned char chr = (unsigned char)*ptr;
+      ctx->map[chr >> 6] |= (uint64_t)1 << (chr & 63);
+   }
+
+   memcpy(ctx->special, ctx->map, sizeof(ctx->map));
+   ctx->special['\\' >> 6] |= (uint64_t)1 << ('\\' & 63);
+
+   if (quotes)
+   {
+      ctx->special['\'' >> 6] |= (uint64_t)1 << ('\'' & 63);
+      ctx->special['"' >> 6] |= (uint64_t)1 << ('"' & 63);
+      ctx->special['$' >> 6] |= (uint64_t)1 << ('$' & 63);
+   }
+
+   unsigned char bits[16] = { 0 };
+   int groups = 0;
+   for (int chr = 0; chr < 256; ++chr)
+   {
+      if (arrayify_map_test(ctx->special, chr))
+      {
+         int high = chr >> 4;
+         if (!bits[high])
+            bits[high] = (unsigned char)(1 << (groups++ % 8));
+
+         ctx->hi_nibbles[high] = bits[high];
+         ctx->lo_nibbles[chr & 15] |= bits[high];
+      }
+   }
+
+   for (int chr = 0; chr < 256; ++chr)
+      ctx->escapes[chr] = (char)chr;
+
+   for (const char *ptr = escapes; *ptr; ++ptr)
+      ctx->escapes[(unsigned char)*ptr] = arrayify_escape_chars[ptr - escapes];
+}
+
 void arrayify_set_ifs(const char *newifs)
 {
    arrayify_ifs = newifs;
+   arrayify_context_init(&arrayify_context, newifs, arrayify_quotes);
+}
+
+/*
+ * Non-zero *quotes* makes the parser treat quotes like the shell:
+ * no splitting or escapes between apostrophes, only \\, \", \$, \`
+ * and line continuation escapes between double quotes, and ANSI-C
+ * escapes between $' and '.  The quote characters are removed.
+ */
+void arrayify_set_quotes(int quotes)
+{
+   arrayify_quotes = quotes;
 }
 
 void arrayify_set_ifs_from_env(void)
@@ -29,6 +156,13 @@ void arrayify_set_ifs_from_env(void)
       arrayify_ifs = env;
 }
 
+/*
+ * Ensures *arrayify_ifs* has a value and that the global context
+ * matches it.  The context is rebuilt only if *arrayify_ifs* points
+ * to a different string, so change IFS with arrayify_set_ifs()
+ * or by assigning a new string, rather than by editing the
+ * current string in place.
+ */
 void arrayify_prep_ifs(void)
 {
    if (arrayify_ifs == NULL)
@@ -37,26 +171,94 @@ void arrayify_prep_ifs(void)
       if (arrayify_ifs == NULL)
          arrayify_ifs = " \t\n";
    }
+
+   if (arrayify_context.ifs != arrayify_ifs
+       || arrayify_context.quotes != arrayify_quotes)
+      arrayify_context_init(&arrayify_context, arrayify_ifs, arrayify_quotes);
+}
+
+// Prepared global context for the functions without _r
+static const ARRAYIFY_CONTEXT *arrayify_global_context(void)
+{
+   arrayify_prep_ifs();
+   return &arrayify_context;
 }
 
 int arrayify_char_is_ifs(int chr)
 {
-   return strchr(arrayify_ifs, chr) != NULL;
+   return arrayify_ctx_is_ifs(&arrayify_context, chr);
 }
 
-char arrayify_escape_chars[] = {
-   '\n',
-   '\t'
-};
+#ifdef ARRAYIFY_SIMD_WIDTH
+/**
+ * Classifies ARRAYIFY_SIMD_WIDTH bytes at *ptr* with two nibble
+ * lookups, returning a bit mask in which bit *n* is set if ptr[n]
+ * may be an IFS character or a backslash.
+ */
+static inline unsigned arrayify_special_mask(const ARRAYIFY_CONTEXT *ctx, const char *ptr)
+{
+#if ARRAYIFY_SIMD_WIDTH == 32
+   __m256i lo_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)ctx->lo_nibbles));
+   __m256i hi_table = _mm256_broadcastsi128_si256(_mm_loadu_si128((const __m128i*)ctx->hi_nibbles));
+   __m256i nibble = _mm256_set1_epi8(0x0f);
 
-const char escapes[] = "nt";
+   __m256i chunk = _mm256_loadu_si256((const __m256i*)ptr);
+   __m256i lo = _mm256_shuffle_epi8(lo_table, _mm256_and_si256(chunk, nibble));
+   __m256i hi = _mm256_shuffle_epi8(hi_table,
+                                    _mm256_and_si256(_mm256_srli_epi16(chunk, 4), nibble));
+   __m256i none = _mm256_cmpeq_epi8(_mm256_and_si256(lo, hi), _mm256_setzero_si256());
+   return ~(unsigned)_mm256_movemask_epi8(none);
+#else
+   __m128i lo_table = _mm_loadu_si128((const __m128i*)ctx->lo_nibbles);
+   __m128i hi_table = _mm_loadu_si128((const __m128i*)ctx->hi_nibbles);
+   __m128i nibble = _mm_set1_epi8(0x0f);
+
+   __m128i chunk = _mm_loadu_si128((const __m128i*)ptr);
+   __m128i lo = _mm_shuffle_epi8(lo_table, _mm_and_si128(chunk, nibble));
+   __m128i hi = _mm_shuffle_epi8(hi_table, _mm_and_si128(_mm_srli_epi16(chunk, 4), nibble));
+   __m128i none = _mm_cmpeq_epi8(_mm_and_si128(lo, hi), _mm_setzero_si128());
+   return ~(unsigned)_mm_movemask_epi8(none) & 0xffff;
+#endif
+}
+#endif
+
+/*
+ * Returns a pointer to the first IFS character or backslash
+ * (or, with quotes, quote character or '$') in [ptr, end),
+ * or *end* if there are none.
+ */
+static inline const char *arrayify_find_special(const ARRAYIFY_CONTEXT *ctx,
+                                                const char *ptr,
+                                                const char *end)
+{
+#ifdef ARRAYIFY_SIMD_WIDTH
+   while (end - ptr >= ARRAYIFY_SIMD_WIDTH)
+   {
+      unsigned mask = arrayify_special_mask(ctx, ptr);
+      while (mask)
+      {
+         const char *found = ptr + __builtin_ctz(mask);
+         if (arrayify_map_test(ctx->special, *found))
+            return found;
+         mask &= mask - 1;
+      }
+      ptr += ARRAYIFY_SIMD_WIDTH;
+   }
+#endif
+
+   while (ptr < end && !arrayify_map_test(ctx->special, *ptr))
+      ++ptr;
+
+   return ptr;
+}
 
 /*
  * Converts escaped IFS chars as well as making IFS chars.
  */
 char arrayify_convert_escaped_char(char c)
 {
-   char *chr = strchr(escapes, c);
+   // strchr() would match '\0' to the terminator of *escapes*
+   char *chr = c ? strchr(escapes, c) : NULL;
    if (chr)
       return arrayify_escape_chars[chr - escapes];
    else
@@ -68,20 +270,26 @@ char arrayify_convert_escaped_char(char c)
  * Returns *end* for no normal characters to preserve termination
  * conditions in arrayify_parser() loop.
  */
-const char *arrayify_trim_ifs(const char *buffer, const char *end)
+static const char *arrayify_ctx_trim_ifs(const ARRAYIFY_CONTEXT *ctx,
+                                         const char *buffer,
+                                         const char *end)
 {
    const char *ptr = buffer;
    while (ptr < end)
    {
       if (*ptr == '\\')
       {
-         char c = arrayify_convert_escaped_char(*(ptr+1));
-         if (!arrayify_char_is_ifs(c))
+         // A backslash that ends the buffer is discarded
+         if (ptr + 1 == end)
+            return end;
+
+         char c = arrayify_ctx_escape(ctx, *(ptr+1));
+         if (!arrayify_ctx_is_ifs(ctx, c))
             return ptr;  // return pointer to the backslash
          else
             ++ptr;       // increment past the backslash
       }
-      else if (!arrayify_char_is_ifs(*ptr))
+      else if (!arrayify_ctx_is_ifs(ctx, *ptr))
          return ptr;
 
       ++ptr;
@@ -90,32 +298,372 @@ const char *arrayify_trim_ifs(const char *buffer, const char *end)
    return end;
 }
 
+const char *arrayify_trim_ifs(const char *buffer, const char *end)
+{
+   return arrayify_ctx_trim_ifs(arrayify_global_context(), buffer, end);
+}
+
+/*
+ * Element pointers collected in one pass by arrayify_split().
+ * The array begins in the *size* pointers at *els*, usually
+ * a small array on the caller's stack.  When that fills, the
+ * elements move to *heap*, which doubles in size as needed, so
+ * the stack use is bounded no matter how many elements there
+ * are.  If *fixed* is set, the array can't grow and adding to
+ * a full array fails, as arrayify_parser() requires.
+ */
+typedef struct arrayify_els_s {
+   const char **els;     // array of element pointers
+   int        count;     // number of elements in *els*
+   int        size;      // capacity of *els*
+   int        fixed;     // set if *els* can't be replaced
+   const char **heap;    // heap memory of *els* after it grows
+   int        errnum;    // ENOMEM if the array couldn't grow
+} ARRAYIFY_ELS;
+
+// Number of elements in the initial array of the single-pass functions
+#ifndef ARRAYIFY_INITIAL_ELS
+#define ARRAYIFY_INITIAL_ELS 64
+#endif
+
+/*
+ * Appends *el* to *list*, moving the array to the heap
+ * or to a larger heap array if it's full.  Returns 0
+ * if the element can't be added.
+ */
+static int arrayify_els_add(ARRAYIFY_ELS *list, const char *el)
+{
+   if (list->count == list->size)
+   {
+      if (list->fixed)
+      {
+         fprintf(stderr, "Attempted arrayify buffer-overrun.\n");
+         return 0;
+      }
+
+      int newsize = list->size ? list->size * 2 : ARRAYIFY_INITIAL_ELS;
+      const char **newels = (const char**)realloc(list->heap, newsize * sizeof(char*));
+      if (!newels)
+      {
+         list->errnum = ENOMEM;
+         return 0;
+      }
+
+      if (!list->heap && list->count)
+         memcpy(newels, list->els, list->count * sizeof(char*));
+
+      list->heap = list->els = newels;
+      list->size = newsize;
+   }
+
+   list->els[list->count++] = el;
+   return 1;
+}
+
+/*
+ * Decodes the ANSI-C escape at *source*, just past a backslash
+ * between $' and ', to *chr*.  Returns the character following
+ * the escape, or NULL for an unknown escape, which is kept with
+ * its backslash as bash does.
+ */
+static const char *arrayify_ansi_escape(const char *source, const char *end, char *chr)
+{
+   int value = 0;
+   int digits = 0;
+
+   switch(*source)
+   {
+      case 'a':  *chr = '\a'; break;
+      case 'b':  *chr = '\b'; break;
+      case 'e':
+      case 'E':  *chr = '\033'; break;
+      case 'f':  *chr = '\f'; break;
+      case 'n':  *chr = '\n'; break;
+      case 'r':  *chr = '\r'; break;
+      case 't':  *chr = '\t'; break;
+      case 'v':  *chr = '\v'; break;
+      case '\\':
+      case '\'':
+      case '"':
+      case '?':  *chr = *source; break;
+
+      case 'c':
+         if (source + 1 == end || source[1] == '\'')
+            return NULL;
+         *chr = (char)(source[1] & 0x1f);
+         return source + 2;
+
+      case 'x':
+         while (digits < 2 && source + 1 + digits < end)
+         {
+            int c = source[1 + digits];
+            if (c >= '0' && c <= '9')
+               value = value * 16 + c - '0';
+            else if ((c | 0x20) >= 'a' && (c | 0x20) <= 'f')
+               value = value * 16 + (c | 0x20) - 'a' + 10;
+            else
+               break;
+            ++digits;
+         }
+         if (!digits)
+            return NULL;
+         *chr = (char)value;
+         return source + 1 + digits;
+
+      default:
+         while (digits < 3 && source + digits < end
+                && source[digits] >= '0' && source[digits] <= '7')
+         {
+            value = value * 8 + source[digits] - '0';
+            ++digits;
+         }
+         if (!digits)
+            return NULL;
+         *chr = (char)value;
+         return source + digits;
+   }
+
+   return source + 1;
+}
+
+// States of arrayify_split_quoted()
+enum arrayify_quote_state {
+   AQ_NONE = 0,     // unquoted
+   AQ_SINGLE,       // between apostrophes
+   AQ_DOUBLE,       // between double quotes
+   AQ_ANSI          // between $' and '
+};
+
+/*
+ * The quote-aware form of arrayify_split(), used when
+ * the context's *quotes* is set.  A state machine over the
+ * buffer, in the same single in-place pass, where each
+ * state moves runs of ordinary characters at once, and
+ * unquoted text is split and escaped as without quotes.
+ *
+ * A quoted empty string, like '' or "", is an element.
+ * An unclosed quote continues to the end of the buffer.
+ * As in bash, a '\0' from an ANSI-C escape ends the $'...'
+ * string, but not the element.
+ */
+static int arrayify_split_quoted(const ARRAYIFY_CONTEXT *ctx,
+                                 char *buffer,
+                                 int bufflen,
+                                 ARRAYIFY_ELS *list)
+{
+   char *end = buffer + bufflen;
+   const char *source = buffer;
+
+   // *target* will be used as flag to enable copying
+   char *target = list ? buffer : NULL;
+
+   enum arrayify_quote_state state = AQ_NONE;
+   int in_element = 0;
+   int dropping = 0;      // set after a '\0' in $'...'
+   int count = 0;
+
+   const char *run;
+   char chr;
+
+   while (source < end)
+   {
+      // Find the end of the run of characters to move
+      switch(state)
+      {
+         case AQ_NONE:
+            run = arrayify_find_special(ctx, source, end);
+            break;
+         case AQ_SINGLE:
+            run = (const char*)memchr(source, '\'', end - source);
+            if (!run)
+               run = end;
+            break;
+         default:
+            run = source;
+            while (run < end && *run != '\\'
+                   && *run != (state == AQ_DOUBLE ? '"' : '\''))
+               ++run;
+            break;
+      }
+
+      if (run > source)
+      {
+         if (!in_element)
+         {
+            in_element = 1;
+            ++count;
+            if (list && !arrayify_els_add(list, target))
+               break;
+         }
+
+         if (target && !dropping)
+         {
+            if (target != source)
+               memmove(target, source, run - source);
+            target += run - source;
+         }
+
+         source = run;
+         if (source == end)
+            break;
+      }
+
+      // Handle the character that ended the run
+      chr = *source++;
+      int keep = 1;       // set if *chr* is part of an element
+      int ends = 0;       // set if *chr* ends the element
+
+      switch(state)
+      {
+         case AQ_NONE:
+            if (chr == '\\')
+            {
+               // Same as arrayify_split() without quotes
+               if (source == end)
+               {
+                  keep = 0;
+                  ends = 1;
+               }
+               else if (arrayify_ctx_is_ifs(ctx, *source))
+                  chr = *source++;
+               else
+               {
+                  chr = arrayify_ctx_escape(ctx, *source++);
+                  if (arrayify_ctx_is_ifs(ctx, chr))
+                  {
+                     keep = 0;
+                     ends = 1;
+                  }
+               }
+            }
+            else if (chr == '\'')
+            {
+               state = AQ_SINGLE;
+               keep = 0;
+            }
+            else if (chr == '"')
+            {
+               state = AQ_DOUBLE;
+               keep = 0;
+            }
+            else if (chr == '$' && source < end && *source == '\'')
+            {
+               ++source;
+               state = AQ_ANSI;
+               keep = 0;
+            }
+            else if (chr != '$')
+            {
+               // An IFS character
+               keep = 0;
+               ends = 1;
+            }
+            break;
+
+         case AQ_SINGLE:
+            state = AQ_NONE;
+            keep = 0;
+            break;
+
+         case AQ_DOUBLE:
+            if (chr == '"')
+            {
+               state = AQ_NONE;
+               keep = 0;
+            }
+            else if (source < end)
+            {
+               // Backslash only escapes these, or joins lines
+               if (*source && strchr("\\\"$`", *source))
+                  chr = *source++;
+               else if (*source == '\n')
+               {
+                  ++source;
+                  keep = 0;
+               }
+            }
+            break;
+
+         case AQ_ANSI:
+            if (chr == '\'')
+            {
+               state = AQ_NONE;
+               keep = 0;
+               dropping = 0;
+            }
+            else if (source < end)
+            {
+               const char *next = arrayify_ansi_escape(source, end, &chr);
+               if (next)
+               {
+                  source = next;
+                  if (chr == '\0')
+                     dropping = 1;
+               }
+            }
+            break;
+      }
+
+      if (ends)
+      {
+         if (in_element)
+         {
+            if (target)
+               *target++ = '\0';
+            in_element = 0;
+         }
+         continue;
+      }
+
+      // An opening quote begins an element, even if it's empty
+      if (!in_element && (keep || state != AQ_NONE))
+      {
+         in_element = 1;
+         ++count;
+         if (list && !arrayify_els_add(list, target))
+            break;
+      }
+
+      if (keep && target && !dropping)
+         *target++ = chr;
+   }
+
+   // Terminate the last element
+   if (target && in_element && target < end)
+      *target = '\0';
+
+   return count;
+}
+
 /*
  * Module's main function, used to count detected elements as
- * well as transforming a string and populating a supplied array.
+ * well as transforming a string and collecting its elements.
  *
  * The input string, supplied in the *buffer* argument, will be
  * split at IFS characters in a manner similar to how the shell
  * splits a string.  It handles escaped characters, but not
  * parameter expansions.
  *
- * If *els* is NULL, then the function only counts the elements.
- * If *els* IS NOT NULL, it fills the array with pointers to
- * into *buffer* as it is split upon IFS boundaries.
+ * If *list* is NULL, then the function only counts the elements.
+ * If *list* IS NOT NULL, each element is appended to *list* as
+ * *buffer* is split upon IFS boundaries.
  *
  * The transformation occurs in the supplied buffer, safely done
  * as the strings can only get shorter with discarded IFS characters
  * and escaped characters needing less space after transformation.
  */
-int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen)
+static int arrayify_split(const ARRAYIFY_CONTEXT *ctx,
+                          char *buffer,
+                          int bufflen,
+                          ARRAYIFY_ELS *list)
 {
-   // IFS is used to mark element boundaries
-   arrayify_prep_ifs();
+   if (ctx->quotes)
+      return arrayify_split_quoted(ctx, buffer, bufflen, list);
    
    // Guardrail for buffer
    char *end = buffer + bufflen;
 
-   const char *source = arrayify_trim_ifs(buffer, end);
+   const char *source = arrayify_ctx_trim_ifs(ctx, buffer, end);
 
    // Early termination for empty string
    if (source >= end)
@@ -124,38 +672,55 @@ int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen)
    // At this point, we have at least one element.
    int count = 1;
 
-   const char **cur_el = els;
-   const char **end_el = els + elslen;
-
    // *target* will be used as flag to enable copying
-   char *target = els ? buffer : NULL;
-   if (target)
-      *cur_el = target;
+   char *target = list ? buffer : NULL;
+   if (target && !arrayify_els_add(list, target))
+      return count;
 
    char prepped_char = 0;
 
    while (source < end)
    {
+      // Move the run of characters before the next IFS or escape
+      const char *special = arrayify_find_special(ctx, source, end);
+      if (special > source)
+      {
+         if (target)
+         {
+            size_t len = special - source;
+            if (target != source)
+               memmove(target, source, len);
+            target += len;
+         }
+
+         source = special;
+         if (source == end)
+            break;
+      }
+
       if (*source == '\\')
       {
          ++source;
 
+         // A backslash that ends the buffer ends the element
+         if (source == end)
+            prepped_char = '\0';
          // (A bit confusing: think about it)
          // If escaped character is IFS, the escape was intended
          // to disarm IFS, the keep in current string.
-         if (arrayify_char_is_ifs(*source))
+         else if (arrayify_ctx_is_ifs(ctx, *source))
             prepped_char = *source;
          else
          {
-            prepped_char = arrayify_convert_escaped_char(*source);
+            prepped_char = arrayify_ctx_escape(ctx, *source);
 
             // If converted character is IFS, then it was intended
             // to be interpreted as IFS, mark as end-of-element
-            if (arrayify_char_is_ifs(prepped_char))
+            if (arrayify_ctx_is_ifs(ctx, prepped_char))
                prepped_char = '\0';
          }
       }
-      else if (arrayify_char_is_ifs(*source))
+      else if (arrayify_ctx_is_ifs(ctx, *source))
          prepped_char = '\0';
       else
          prepped_char = *source;
@@ -171,24 +736,14 @@ int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen)
       // Signal to end the current element:
       if (prepped_char == '\0')
       {
-         source = arrayify_trim_ifs(source, end);
+         source = arrayify_ctx_trim_ifs(ctx, source, end);
 
          if (source < end)
          {
             ++count;
 
-            if (els)
-            {
-               ++cur_el;
-
-               if (cur_el < end_el)
-                  *cur_el = target;
-               else
-               {
-                  fprintf(stderr, "Attempted arrayify buffer-overrun.\n");
-                  break;
-               }
-            }
+            if (list && !arrayify_els_add(list, target))
+               break;
          }
          else
             break;
@@ -196,9 +751,73 @@ int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen)
       }
    }
 
+   // Terminate the last element if escapes shortened it
+   if (target && target < end)
+      *target = '\0';
+
    return count;
 }
 
+/*
+ * Counts the elements of *buffer* if *els* is NULL.  Otherwise,
+ * fills *els*, which must have room for *elslen* pointers, with
+ * the elements as it splits the string in place.  Use the count
+ * from the first call to size *els* for the second call.
+ */
+int arrayify_parser_r(const ARRAYIFY_CONTEXT *ctx,
+                      char *buffer,
+                      int bufflen,
+                      const char **els,
+                      int elslen)
+{
+   if (els)
+   {
+      ARRAYIFY_ELS list = { els, 0, elslen, 1 };
+      return arrayify_split(ctx, buffer, bufflen, &list);
+   }
+   else
+      return arrayify_split(ctx, buffer, bufflen, NULL);
+}
+
+int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen)
+{
+   return arrayify_parser_r(arrayify_global_context(), buffer, bufflen, els, elslen);
+}
+
+/**
+ * Parse char* string in *buffer* into an array of char* string
+ * elements in a single pass, collecting the elements in an array
+ * that grows as needed, rather than counting the elements first.
+ * Call *user* callback function with the new array, its length,
+ * and the optional *closure*.
+ *
+ * Returns 0 for success, or ENOMEM if the array couldn't grow,
+ * in which case *user* is not called.
+ */
+int arrayify_string_r(const ARRAYIFY_CONTEXT *ctx,
+                      char *buffer,
+                      int bufflen,
+                      arrayify_user_f user,
+                      void *closure)
+{
+   const char *initial[ARRAYIFY_INITIAL_ELS];
+   ARRAYIFY_ELS list = { initial, 0, ARRAYIFY_INITIAL_ELS };
+
+   arrayify_split(ctx, buffer, bufflen, &list);
+
+   if (!list.errnum)
+      (*user)(list.count, list.els, closure);
+
+   free(list.heap);
+
+   return list.errnum;
+}
+
+int arrayify_string_once(char *buffer, int bufflen, arrayify_user_f user, void *closure)
+{
+   return arrayify_string_r(arrayify_global_context(), buffer, bufflen, user, closure);
+}
+
 /**
  * Parse char* string in *buffer* into an array of char* string elements.
  * Call *user* callback function with the new array, its length, and the
@@ -208,59 +827,865 @@ int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen)
  */
 void arrayify_string(char *buffer, int bufflen, arrayify_user_f user, void *closure)
 {
-   int count = arrayify_parser(buffer, bufflen, NULL, 0);
-   const char *els[count];
-   memset(els, 0, sizeof(els));
-
-   arrayify_parser(buffer, bufflen, els, count);
-
-   (*user)(count, (const char**)els, closure);
+   arrayify_string_once(buffer, bufflen, user, closure);
 }
 
 /*
  * Performs several tasks associated with preparing to use
  * *arrayify_string* with the contents of a disk file.
+ *
+ * The file is split in a private memory map with
+ * arrayify_map_file(), so the size of the file is not
+ * limited by the stack.  Returns 0 for success, the
+ * errno value if it fails.
  */
 int arrayify_file(const char *path, arrayify_user_f user, void *closure)
 {
-   struct stat lstat;
-   if (stat(path, &lstat) == 0)
+   return arrayify_map_file(path, user, closure);
+}
+
+/*
+ * Reads the file into heap memory and splits it with
+ * arrayify_string_r(), so the stack use doesn't depend on
+ * the size of the file or the number of elements.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+static int arrayify_read_file(const ARRAYIFY_CONTEXT *ctx,
+                              const char *path,
+                              arrayify_user_f user,
+                              void *closure)
+{
+   int errnum = 0;
+   int fh = open(path, O_RDONLY);
+   if (fh == -1)
+      return errno;
+
+   struct stat st;
+   if (fstat(fh, &st))
+      errnum = errno;
+   else if (st.st_size > 0)
    {
-      unsigned size = lstat.st_size;
-      if (size > 0)
+      size_t size = (size_t)st.st_size;
+      char *buffer = (char*)malloc(size + 1);
+      if (!buffer)
+         errnum = ENOMEM;
+      else
       {
-         int fh = open(path, O_RDONLY);
-         if (fh)
+         size_t total = 0;
+         ssize_t bytes_read = 0;
+         while (total < size
+                && (bytes_read = read(fh, buffer + total, size - total)) > 0)
+            total += (size_t)bytes_read;
+
+         if (bytes_read == -1)
+            errnum = errno;
+         else
          {
-            char buffer[size+1];
-            unsigned bytes_read = read(fh, buffer, size+1);
-            if (bytes_read < size+1)
-               buffer[bytes_read] = '\0';
+            buffer[total] = '\0';
+            errnum = arrayify_string_r(ctx, buffer, (int)total, user, closure);
+         }
+
+         free(buffer);
+      }
+   }
+
+   close(fh);
+   return errnum;
+}
+
+/*
+ * Like arrayify_file(), but reads the file into heap memory and
+ * splits it with arrayify_string_once(), so the stack use doesn't
+ * depend on the size of the file or the number of elements.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int arrayify_file_once(const char *path, arrayify_user_f user, void *closure)
+{
+   return arrayify_read_file(arrayify_global_context(), path, user, closure);
+}
+
+
+/*
+ * Splits a file in a copy-on-write memory map of the file, with
+ * no stack buffer and no copy by read().  The parser writes into
+ * the mapping, and MAP_PRIVATE keeps the changes out of the file.
+ *
+ * The elements need a '\0' after the last byte of the file.  The
+ * rest of the last page of a mapping is zeroed, but when the file
+ * ends on a page boundary, a zeroed anonymous page is mapped first
+ * and the file is mapped over its beginning.  Files that can't be
+ * mapped are read into heap memory instead.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int arrayify_map_file_r(const ARRAYIFY_CONTEXT *ctx,
+                        const char *path,
+                        arrayify_user_f user,
+                        void *closure)
+{
+   int errnum = 0;
+   int fh = open(path, O_RDONLY);
+   if (fh == -1)
+      return errno;
+
+   struct stat st;
+   if (fstat(fh, &st))
+   {
+      errnum = errno;
+      close(fh);
+      return errnum;
+   }
+
+   if (!S_ISREG(st.st_mode) || st.st_size == 0)
+   {
+      close(fh);
+      return arrayify_read_file(ctx, path, user, closure);
+   }
+
+   if (st.st_size > INT_MAX)
+   {
+      close(fh);
+      return EFBIG;
+   }
+
+   size_t size = (size_t)st.st_size;
+   size_t page = (size_t)sysconf(_SC_PAGESIZE);
+   size_t map_len = size;
+   char *map = (char*)MAP_FAILED;
+
+   if (size % page)
+      map = (char*)mmap(NULL, size, PROT_READ | PROT_WRITE, MAP_PRIVATE, fh, 0);
+#ifdef MAP_ANONYMOUS
+   else
+   {
+      map_len = size + page;
+      map = (char*)mmap(NULL, map_len, PROT_READ | PROT_WRITE,
+                        MAP_PRIVATE | MAP_ANONYMOUS, -1, 0);
+      if (map != (char*)MAP_FAILED
+          && mmap(map, size, PROT_READ | PROT_WRITE,
+                  MAP_PRIVATE | MAP_FIXED, fh, 0) == MAP_FAILED)
+      {
+         munmap(map, map_len);
+         map = (char*)MAP_FAILED;
+      }
+   }
+#endif
 
-            // Don't include terminating \0 in bytes_read count:
-            arrayify_string(buffer, bytes_read, user, closure);
+   // The mapping remains after the file is closed
+   close(fh);
 
-            close(fh);
+   if (map == (char*)MAP_FAILED)
+      return arrayify_read_file(ctx, path, user, closure);
+
+   errnum = arrayify_string_r(ctx, map, (int)size, user, closure);
+
+   munmap(map, map_len);
+
+   return errnum;
+}
+
+int arrayify_map_file(const char *path, arrayify_user_f user, void *closure)
+{
+   return arrayify_map_file_r(arrayify_global_context(), path, user, closure);
+}
+
+/*
+ * Splitting a large buffer in ranges on several threads.
+ */
+
+// Smallest range worth a thread in arrayify_string_parallel()
+#ifndef ARRAYIFY_MIN_RANGE
+#define ARRAYIFY_MIN_RANGE (64 * 1024)
+#endif
+
+typedef struct arrayify_range_s {
+   const ARRAYIFY_CONTEXT *ctx;
+   char         *start;
+   char         *end;
+   ARRAYIFY_ELS list;
+} ARRAYIFY_RANGE;
+
+/*
+ * Returns the position following the first IFS character at or
+ * after *ptr* that isn't escaped, or *end* if there is none.
+ *
+ * A character is escaped if an odd number of backslashes precede
+ * it.  The run of backslashes follows a character that isn't a
+ * backslash, whether or not that character was itself escaped,
+ * so the count doesn't depend on anything before the run, and
+ * the boundary can be found without parsing from the beginning.
+ */
+static char *arrayify_next_boundary(const ARRAYIFY_CONTEXT *ctx,
+                                    char *begin,
+                                    char *ptr,
+                                    char *end)
+{
+   for (; ptr < end; ++ptr)
+   {
+      if (arrayify_ctx_is_ifs(ctx, *ptr))
+      {
+         const char *run = ptr;
+         while (run > begin && run[-1] == '\\')
+            --run;
+
+         if (((ptr - run) & 1) == 0)
+            return ptr + 1;
+      }
+   }
+
+   return end;
+}
+
+/*
+ * Split one range into its own list.  Runs as a thread function.
+ */
+static void *arrayify_range_split(void *data)
+{
+   ARRAYIFY_RANGE *range = (ARRAYIFY_RANGE*)data;
+   if (range->end > range->start)
+      arrayify_split(range->ctx, range->start, (int)(range->end - range->start), &range->list);
+   return NULL;
+}
+
+/*
+ * Like arrayify_string_r(), but divides *buffer* into *threads*
+ * ranges that are split at the same time.  Each range ends just
+ * after an IFS character that isn't escaped, where the serial parse
+ * would also end an element, so each range can be parsed on its
+ * own.  The element arrays of the ranges are then joined in order
+ * for a single call to *user*, with the same elements as
+ * arrayify_parser_r().
+ *
+ * With quotes, finding a boundary needs the quote state from the
+ * beginning of the buffer, so the buffer is split in one pass by
+ * arrayify_string_r(), as is a buffer too small to be worth
+ * dividing.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int arrayify_string_parallel_r(const ARRAYIFY_CONTEXT *ctx,
+                               char *buffer,
+                               int bufflen,
+                               int threads,
+                               arrayify_user_f user,
+                               void *closure)
+{
+   if (threads < 1)
+      return EINVAL;
+
+   if (bufflen / threads < ARRAYIFY_MIN_RANGE)
+      threads = bufflen / ARRAYIFY_MIN_RANGE;
+
+   if (ctx->quotes || threads < 2)
+      return arrayify_string_r(ctx, buffer, bufflen, user, closure);
+
+   char *end = buffer + bufflen;
+
+   ARRAYIFY_RANGE ranges[threads];
+   pthread_t tids[threads];
+   int started[threads];
+
+   memset(ranges, 0, sizeof(ranges));
+
+   char *range_start = buffer;
+   for (int i = 0; i < threads; ++i)
+   {
+      char *range_end = end;
+      if (i + 1 < threads)
+      {
+         range_end = buffer + (size_t)bufflen / threads * (i+1);
+         if (range_end < range_start)
+            range_end = range_start;
+         range_end = arrayify_next_boundary(ctx, buffer, range_end, end);
+      }
+
+      ranges[i].ctx = ctx;
+      ranges[i].start = range_start;
+      ranges[i].end = range_end;
+
+      range_start = range_end;
+   }
+
+   // Range 0 runs in this thread, as does any range
+   // for which a thread can't be started.
+   for (int i = 1; i < threads; ++i)
+   {
+      started[i] = !pthread_create(&tids[i], NULL, arrayify_range_split, &ranges[i]);
+      if (!started[i])
+         arrayify_range_split(&ranges[i]);
+   }
+
+   arrayify_range_split(&ranges[0]);
+
+   int errnum = 0;
+   int total = 0;
+   for (int i = 0; i < threads; ++i)
+   {
+      if (i > 0 && started[i])
+         pthread_join(tids[i], NULL);
+
+      if (ranges[i].list.errnum)
+         errnum = ranges[i].list.errnum;
+      total += ranges[i].list.count;
+   }
+
+   // Append the elements of the other ranges to those of range 0
+   ARRAYIFY_ELS *first = &ranges[0].list;
+   if (!errnum && total > first->count)
+   {
+      const char **els = (const char**)realloc(first->heap, total * sizeof(char*));
+      if (!els)
+         errnum = ENOMEM;
+      else
+      {
+         first->heap = first->els = els;
+         for (int i = 1; i < threads; ++i)
+         {
+            if (!ranges[i].list.count)
+               continue;
+            memcpy(els + first->count,
+                   ranges[i].list.els,
+                   ranges[i].list.count * sizeof(char*));
+            first->count += ranges[i].list.count;
          }
       }
    }
 
-   return errno;
+   if (!errnum)
+   {
+      const char *none[1] = { NULL };
+      (*user)(total, total ? first->els : none, closure);
+   }
+
+   for (int i = 0; i < threads; ++i)
+      free(ranges[i].list.heap);
+
+   return errnum;
+}
+
+/*
+ * Splits with the global context, which is compiled before the
+ * threads share it.  See arrayify_string_parallel_r().
+ */
+int arrayify_string_parallel(char *buffer,
+                             int bufflen,
+                             int threads,
+                             arrayify_user_f user,
+                             void *closure)
+{
+   return arrayify_string_parallel_r(arrayify_global_context(),
+                                     buffer, bufflen, threads, user, closure);
+}
+
+
+/*
+ * Reading a file by lines, splitting each line into fields.
+ */
+
+// Length of the buffer for arrayify_handle_lines(), default 2048,
+// which limits the length of a line
+unsigned arrayify_line_bufflen = 2048;
+
+// Byte classes for arrayify_handle_lines()
+enum arrayify_class {
+   AC_NORMAL = 0,
+   AC_IFS,
+   AC_ESCAPE,
+   AC_EOL
+};
+
+/*
+ * Fill a table with the class of every byte value, using the
+ * IFS of *ctx*.  '\r' and '\n' always end a line, even if IFS
+ * includes them.
+ */
+static void arrayify_ctx_class_table(const ARRAYIFY_CONTEXT *ctx, unsigned char *table)
+{
+   for (int chr = 0; chr < 256; ++chr)
+      table[chr] = arrayify_ctx_is_ifs(ctx, chr) ? AC_IFS : AC_NORMAL;
+
+   table['\\'] = AC_ESCAPE;
+   table['\r'] = AC_EOL;
+   table['\n'] = AC_EOL;
+}
+
+void arrayify_make_class_table(unsigned char *table)
+{
+   arrayify_ctx_class_table(arrayify_global_context(), table);
+}
+
+/*
+ * Read lines from *fh*, splitting each line into fields with the
+ * same rules as arrayify_parser() without quotes, and call *user* with the fields
+ * of each line.  Lines are read and split in one pass over each
+ * buffer: each byte is classified once, and the fields are
+ * terminated and unescaped in place in the read buffer.  Like
+ * main(), argv[argc] is NULL.  An empty line produces argc 0.
+ *
+ * Lines end with '\n', '\r', or "\r\n", as with read_file_lines().
+ * A backslash before the end of a line joins the next line.
+ *
+ * The fields are only valid until *user* returns.  A line that
+ * doesn't fit in *arrayify_line_bufflen* bytes stops reading and
+ * returns EOVERFLOW.
+ *
+ * The byte classes have no quote states, so a context with *quotes*
+ * set is refused with EINVAL, rather than splitting quoted fields.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int arrayify_handle_lines_r(const ARRAYIFY_CONTEXT *ctx,
+                            int fh,
+                            arrayify_user_f user,
+                            void *closure)
+{
+   if (ctx->quotes)
+      return EINVAL;
+
+   unsigned char table[256];
+   arrayify_ctx_class_table(ctx, table);
+
+   char buffer[arrayify_line_bufflen];
+   char *buffend = buffer + sizeof(buffer);
+
+   // A field needs a character and a separator, plus room for NULL
+   const char *argv[arrayify_line_bufflen / 2 + 2];
+   int argc = 0;
+
+   char *line = buffer;         // start of the current line's fields
+   char *target = buffer;       // where the next field character goes
+   char *source = buffer;       // next character to classify
+   char *end_read = buffer;     // end of the data in the buffer
+
+   int in_field = 0;            // set when *target* extends a field
+   int in_line = 0;             // set when the current line has characters
+   int skip_lf = 0;             // set if the previous read ended with '\r'
+   int at_eof = 0;
+
+   ssize_t bytes_read;
+
+   for (;;)
+   {
+      // Make room: move the current line to the beginning of the buffer
+      if (line > buffer)
+      {
+         size_t field_len = target - line;
+         size_t raw_len = end_read - source;
+         size_t shift = line - buffer;
+
+         memmove(buffer, line, field_len);
+         memmove(buffer + field_len, source, raw_len);
+
+         for (int i = 0; i < argc; ++i)
+            argv[i] -= shift;
+
+         line = buffer;
+         target = buffer + field_len;
+         source = target;
+         end_read = source + raw_len;
+      }
+
+      if (end_read == buffend)
+         return EOVERFLOW;
+
+      bytes_read = read(fh, end_read, buffend - end_read);
+      if (bytes_read == -1)
+         return errno;
+
+      at_eof = bytes_read == 0;
+      end_read += bytes_read;
+
+      if (skip_lf && source < end_read)
+      {
+         if (*source == '\n')
+            line = target = ++source;
+         skip_lf = 0;
+      }
+
+      while (source < end_read)
+      {
+         unsigned char chr = (unsigned char)*source;
+         switch(table[chr])
+         {
+            case AC_NORMAL:
+               if (!in_field)
+               {
+                  argv[argc++] = target;
+                  in_field = 1;
+               }
+               *target++ = (char)chr;
+               ++source;
+               in_line = 1;
+               break;
+
+            case AC_IFS:
+               if (in_field)
+               {
+                  *target++ = '\0';
+                  in_field = 0;
+               }
+               ++source;
+               in_line = 1;
+               break;
+
+            case AC_EOL:
+               if (in_field)
+               {
+                  *target++ = '\0';
+                  in_field = 0;
+               }
+               argv[argc] = NULL;
+               (*user)(argc, argv, closure);
+               argc = 0;
+               in_line = 0;
+
+               // The terminator may have overwritten *source, so test *chr*
+               ++source;
+               if (chr == '\r')
+               {
+                  if (source == end_read)
+                     skip_lf = 1;
+                  else if (*source == '\n')
+                     ++source;
+               }
+               line = target = source;
+               break;
+
+            case AC_ESCAPE:
+            {
+               // Wait for the escaped character, or "\r\n" pair
+               const char *escaped = source + 1;
+               if (!at_eof
+                   && (escaped == end_read
+                       || (*escaped == '\r' && escaped + 1 == end_read)))
+                  goto read_more;
+
+               in_line = 1;
+
+               // Line continuation
+               if (escaped < end_read && table[(unsigned char)*escaped] == AC_EOL)
+               {
+                  if (*escaped++ == '\r' && escaped < end_read && *escaped == '\n')
+                     ++escaped;
+                  source = (char*)escaped;
+                  break;
+               }
+
+               // As in arrayify_parser(), a trailing backslash is dropped,
+               // and an escaped IFS character is kept within a field,
+               // but skipped like IFS before a field begins
+               if (escaped == end_read)
+                  chr = '\0';
+               else if (table[(unsigned char)*escaped] == AC_IFS)
+                  chr = in_field ? (unsigned char)*escaped : '\0';
+               else
+               {
+                  chr = (unsigned char)arrayify_ctx_escape(ctx, *escaped);
+                  if (arrayify_ctx_is_ifs(ctx, chr))
+                     chr = '\0';
+               }
+
+               source = (char*)(escaped < end_read ? escaped + 1 : escaped);
+
+               if (chr == '\0')
+               {
+                  if (in_field)
+                  {
+                     *target++ = '\0';
+                     in_field = 0;
+                  }
+               }
+               else
+               {
+                  if (!in_field)
+                  {
+                     argv[argc++] = target;
+                     in_field = 1;
+                  }
+                  *target++ = (char)chr;
+               }
+               break;
+            }
+         }
+      }
+
+     read_more:
+      if (at_eof)
+         break;
+   }
+
+   // Final line without a line ending
+   if (in_line)
+   {
+      // *target* may be *buffend* if the last field fills the buffer
+      if (in_field)
+      {
+         if (target == buffend)
+            return EOVERFLOW;
+         *target = '\0';
+      }
+      argv[argc] = NULL;
+      (*user)(argc, argv, closure);
+   }
+
+   return 0;
+}
+
+int arrayify_handle_lines(int fh, arrayify_user_f user, void *closure)
+{
+   return arrayify_handle_lines_r(arrayify_global_context(), fh, user, closure);
+}
+
+int arrayify_file_lines(const char *filepath, arrayify_user_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = arrayify_handle_lines(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+
+/*
+ * Streaming a file of any size in chunks, with memory for the
+ * longest element rather than for the whole file.
+ */
+
+// Length of the first buffer of arrayify_handle_stream(), default
+// 64K, which doubles if an element doesn't fit
+unsigned arrayify_stream_bufflen = 64 * 1024;
+
+/*
+ * Returns the position following the last IFS character in
+ * [start, end) that isn't escaped, or *start* if there is none.
+ * *start* must be at the beginning of an element or of IFS,
+ * so a run of backslashes is not cut off at *start*.
+ */
+static const char *arrayify_plain_boundary(const ARRAYIFY_CONTEXT *ctx,
+                                           const char *start,
+                                           const char *end)
+{
+   const char *ptr = end;
+   while (ptr > start)
+   {
+      --ptr;
+      if (arrayify_ctx_is_ifs(ctx, *ptr))
+      {
+         // An odd number of backslashes escapes the IFS character
+         const char *run = ptr;
+         while (run > start && run[-1] == '\\')
+            --run;
+
+         if (((ptr - run) & 1) == 0)
+            return ptr + 1;
+
+         ptr = run;
+      }
+   }
+
+   return start;
+}
+
+/*
+ * The quote-aware form of arrayify_plain_boundary(), which must
+ * follow the quotes from *start* to ignore quoted IFS characters.
+ */
+static const char *arrayify_quoted_boundary(const ARRAYIFY_CONTEXT *ctx,
+                                            const char *start,
+                                            const char *end)
+{
+   enum arrayify_quote_state state = AQ_NONE;
+   const char *boundary = start;
+   const char *ptr = start;
+
+   while (ptr < end)
+   {
+      char chr = *ptr++;
+      switch(state)
+      {
+         case AQ_NONE:
+            if (chr == '\\')
+            {
+               if (ptr < end)
+                  ++ptr;
+            }
+            else if (chr == '\'')
+               state = AQ_SINGLE;
+            else if (chr == '"')
+               state = AQ_DOUBLE;
+            else if (chr == '$' && ptr < end && *ptr == '\'')
+            {
+               ++ptr;
+               state = AQ_ANSI;
+            }
+            else if (arrayify_ctx_is_ifs(ctx, chr))
+               boundary = ptr;
+            break;
+
+         case AQ_SINGLE:
+            if (chr == '\'')
+               state = AQ_NONE;
+            break;
+
+         case AQ_DOUBLE:
+         case AQ_ANSI:
+            if (chr == '\\')
+            {
+               if (ptr < end)
+                  ++ptr;
+            }
+            else if (chr == (state == AQ_DOUBLE ? '"' : '\''))
+               state = AQ_NONE;
+            break;
+      }
+   }
+
+   return boundary;
+}
+
+/*
+ * Read elements from *fh* in chunks, calling *user* with the
+ * complete elements of each chunk, in order, as they are read.
+ * The text after the last unescaped (and, with quotes, unquoted)
+ * IFS character of a chunk is kept for the next chunk, so an
+ * element or an escape may span chunks.  If the buffer fills
+ * without a complete element, it doubles in size, so memory use
+ * depends on the longest element, not on the size of the input.
+ * Pipes and terminals can be read as well as files.
+ *
+ * The elements are only valid until *user* returns.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int arrayify_handle_stream_r(const ARRAYIFY_CONTEXT *ctx,
+                             int fh,
+                             arrayify_user_f user,
+                             void *closure)
+{
+   int errnum = 0;
+   size_t bufflen = arrayify_stream_bufflen ? arrayify_stream_bufflen : 1;
+
+   // Leave room for a '\0' after an element at the end of the buffer
+   char *buffer = (char*)malloc(bufflen + 1);
+   if (!buffer)
+      return ENOMEM;
+
+   const char *initial[ARRAYIFY_INITIAL_ELS];
+   ARRAYIFY_ELS list = { initial, 0, ARRAYIFY_INITIAL_ELS };
+
+   size_t used = 0;    // length of the unparsed text in *buffer*
+   int at_eof = 0;
+
+   while (!at_eof)
+   {
+      if (used == bufflen)
+      {
+         char *newbuff = (char*)realloc(buffer, bufflen * 2 + 1);
+         if (!newbuff)
+         {
+            errnum = ENOMEM;
+            break;
+         }
+
+         buffer = newbuff;
+         bufflen *= 2;
+      }
+
+      ssize_t bytes_read = read(fh, buffer + used, bufflen - used);
+      if (bytes_read == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         errnum = errno;
+         break;
+      }
+
+      at_eof = bytes_read == 0;
+      used += (size_t)bytes_read;
+
+      // Parse up to the end of the last complete element
+      const char *split = buffer + used;
+      if (!at_eof)
+         split = (ctx->quotes ? arrayify_quoted_boundary : arrayify_plain_boundary)
+            (ctx, buffer, buffer + used);
+      else
+         buffer[used] = '\0';
+
+      if (split > buffer)
+      {
+         list.count = 0;
+         arrayify_split(ctx, buffer, (int)(split - buffer), &list);
+         if (list.errnum)
+         {
+            errnum = list.errnum;
+            break;
+         }
+
+         if (list.count)
+            (*user)(list.count, list.els, closure);
+
+         used -= split - buffer;
+         memmove(buffer, split, used);
+      }
+   }
+
+   free(list.heap);
+   free(buffer);
+
+   return errnum;
+}
+
+int arrayify_handle_stream(int fh, arrayify_user_f user, void *closure)
+{
+   return arrayify_handle_stream_r(arrayify_global_context(), fh, user, closure);
+}
+
+int arrayify_file_stream(const char *filepath, arrayify_user_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = arrayify_handle_stream(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
 }
 
 
 #ifdef ARRAYIFY_MAIN
 
 #include <stdio.h>
+#include <time.h>      // for clock_gettime()
 #include <readargs.h>
 
 const char *filepath = NULL;
 int show_ifs_flag = 0;
+int lines_flag = 0;
+int stream_flag = 0;
+int bench_flag = 0;
+int escapes_flag = 0;
 
 raAction actions[] = {
    {'h', "help", "This help display", &ra_show_help_agent },
    {'i', "set-ifs", "Set IFS", &ra_string_agent, &arrayify_ifs },
    {'I', "show-ifs", "Display IFS", &ra_flag_agent, &show_ifs_flag },
+   {'b', "bench", "Time threads splitting the file", &ra_flag_agent, &bench_flag },
+   {'e', "escapes", "Compare escapes of the parser and line reader", &ra_flag_agent, &escapes_flag },
+   {'l', "lines", "Split each line of the file", &ra_flag_agent, &lines_flag },
+   {'q', "quotes", "Recognize shell quotes", &ra_flag_agent, &arrayify_quotes },
+   {'s', "stream", "Read the file in chunks", &ra_flag_agent, &stream_flag },
    {-1, "*file", "File to parse", &ra_string_agent, &filepath }
 };
 
@@ -289,6 +1714,168 @@ void alt_main(int argc, const char **argv, void *closure)
    }
 }
 
+void show_brackets(int argc, const char **argv, void *closure)
+{
+   printf("%-10s", (const char*)closure);
+   for (int i = 0; i < argc; ++i)
+      printf("[%s]", argv[i]);
+   printf("\n");
+}
+
+/*
+ * Split samples with escaped separators and a trailing backslash
+ * by arrayify_string() and, through a pipe, by the line reader,
+ * which should give the same elements.
+ */
+void show_escapes(void)
+{
+   const char *samples[] = { "a \\ b", "\\ a", "a\\" };
+   const char **end = samples + sizeof(samples) / sizeof(samples[0]);
+
+   for (const char **ptr = samples; ptr < end; ++ptr)
+   {
+      int len = strlen(*ptr);
+      char buffer[len + 1];
+      memcpy(buffer, *ptr, len + 1);
+
+      printf("Sample: %s\n", *ptr);
+      arrayify_string(buffer, len, show_brackets, "  parser");
+
+      int fds[2];
+      if (pipe(fds))
+      {
+         printf("Failed to make a pipe: %s.\n", strerror(errno));
+         return;
+      }
+      write(fds[1], *ptr, len);
+      close(fds[1]);
+
+      int errnum = arrayify_handle_lines(fds[0], show_brackets, "  lines");
+      close(fds[0]);
+      if (errnum)
+         printf("Error reading lines: %s.\n", strerror(errnum));
+   }
+}
+
+/*
+ * Benchmark of threads that split the same text at once, each
+ * with its own context and a different IFS, so they can only
+ * scale if they share no mutable state.
+ */
+
+// Number of times each benchmark thread splits the text
+int bench_rounds = 20;
+
+typedef struct bench_job_s {
+   const char *text;      // shared, read-only text to split
+   int        len;        // length of *text*
+   const char *ifs;       // IFS of this thread's context
+   long       elements;   // total elements found, to keep the work
+} BENCH_JOB;
+
+void bench_count(int argc, const char **argv, void *closure)
+{
+   *(long*)closure += argc;
+}
+
+void *bench_thread(void *data)
+{
+   BENCH_JOB *job = (BENCH_JOB*)data;
+
+   ARRAYIFY_CONTEXT ctx;
+   arrayify_context_init(&ctx, job->ifs, arrayify_quotes);
+
+   // The text is split in place, so each round splits a fresh copy
+   char *copy = (char*)malloc(job->len + 1);
+   if (copy)
+   {
+      for (int round = 0; round < bench_rounds; ++round)
+      {
+         memcpy(copy, job->text, job->len + 1);
+         arrayify_string_r(&ctx, copy, job->len, bench_count, &job->elements);
+      }
+      free(copy);
+   }
+
+   return NULL;
+}
+
+// Elapsed nanoseconds running *thread_count* threads at once
+long bench_threads(const char *text, int len, int thread_count)
+{
+   static const char *ifs_list[] = { " \t\n", " ", ",; \t\n", "\n" };
+
+   pthread_t threads[thread_count];
+   BENCH_JOB jobs[thread_count];
+
+   struct timespec ts_start, ts_end;
+   clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+   for (int i = 0; i < thread_count; ++i)
+   {
+      jobs[i] = (BENCH_JOB){ text, len, ifs_list[i % 4], 0 };
+      pthread_create(&threads[i], NULL, bench_thread, &jobs[i]);
+   }
+
+   for (int i = 0; i < thread_count; ++i)
+      pthread_join(threads[i], NULL);
+
+   clock_gettime(CLOCK_MONOTONIC, &ts_end);
+
+   return (ts_end.tv_sec - ts_start.tv_sec) * 1000000000L
+      + (ts_end.tv_nsec - ts_start.tv_nsec);
+}
+
+// Report throughput from one thread up to twice the processors
+void bench_file(const char *path)
+{
+   int fh = open(path, O_RDONLY);
+   if (fh == -1)
+   {
+      printf("Error opening %s: %s.\n", path, strerror(errno));
+      return;
+   }
+
+   struct stat st;
+   char *text = NULL;
+   int len = 0;
+   if (!fstat(fh, &st) && st.st_size > 0 && st.st_size < INT_MAX
+       && (text = (char*)malloc(st.st_size + 1)))
+   {
+      len = (int)read(fh, text, st.st_size);
+      if (len < 0)
+         len = 0;
+      text[len] = '\0';
+   }
+   close(fh);
+
+   if (len == 0)
+      printf("Nothing to split in %s.\n", path);
+   else
+   {
+      long cores = sysconf(_SC_NPROCESSORS_ONLN);
+      if (cores < 1)
+         cores = 1;
+
+      printf("Splitting %d bytes, %d times per thread, on %ld processors\n",
+             len, bench_rounds, cores);
+      printf("  threads       MB/sec   scaling\n");
+
+      double single_rate = 0.0;
+      for (int threads = 1; threads <= cores * 2; threads *= 2)
+      {
+         long nsecs = bench_threads(text, len, threads);
+         double rate = (double)len * bench_rounds * threads * 1e3 / nsecs;
+         if (threads == 1)
+            single_rate = rate;
+
+         printf("  %7d  %11.1f  %7.2fx\n", threads, rate, rate / single_rate);
+      }
+   }
+
+   free(text);
+}
+
 int main(int argc, const char **argv)
 {
    ra_set_scene(argv, argc, actions, ACTS_COUNT(actions));
@@ -298,7 +1885,23 @@ int main(int argc, const char **argv)
       if (show_ifs_flag)
          show_ifs();
       
-      if (filepath)
+      if (escapes_flag)
+         show_escapes();
+      else if (filepath && bench_flag)
+         bench_file(filepath);
+      else if (filepath && lines_flag)
+      {
+         int errnum = arrayify_file_lines(filepath, alt_main, NULL);
+         if (errnum)
+            printf("Error reading lines: %s.\n", strerror(errnum));
+      }
+      else if (filepath && stream_flag)
+      {
+         int errnum = arrayify_file_stream(filepath, alt_main, NULL);
+         if (errnum)
+            printf("Error reading stream: %s.\n", strerror(errnum));
+      }
+      else if (filepath)
          arrayify_file(filepath, alt_main, NULL);
       else
          printf("Nothing to do.\n");
@@ -311,8 +1914,8 @@ int main(int argc, const char **argv)
 /* compile-command: "b=arrayify; \*/
 /*  cc -Wall -Werror -ggdb        \*/
 /*  -std=c99 -pedantic            \*/
-/*  -lreadargs                    \*/
-/*  -D${b^^}_MAIN -o $b ${b}.c"   \*/
+/*  -D${b^^}_MAIN -o $b ${b}.c    \*/
+/*  -lreadargs -lpthread"         \*/
 /* End: */
 
 #endif
@@ -1,6 +1,7 @@
 #ifndef ARRAYIFY_H
 #define ARRAYIFY_H
 
+#include <stdint.h>   // for uint64_t
 
 typedef void (*arrayify_user_f)(int argc, const char **argv, void *closure);
 
@@ -10,6 +11,10 @@ typedef void (*arrayify_user_f)(int argc, const char **argv, void *closure);
 // and any IFS value set in the environment.
 void arrayify_set_ifs(const char *newifs);
 
+// Non-zero *quotes* makes arrayify_parser recognize shell quotes:
+// '...', "..." with backslash escapes, and $'...' ANSI-C escapes.
+void arrayify_set_quotes(int quotes);
+
 // Double-purpose function, to count elements when *els* is NULL,
 // then to fill the *els* array with separated strings if *els* is included.
 int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen);
@@ -17,7 +22,96 @@ int arrayify_parser(char *buffer, int bufflen, const char **els, int elslen);
 // Short cut, using arrayify_parser, to deliver an array of strings.
 void arrayify_string(char *buffer, int bufflen, arrayify_user_f user, void *closure);
 
-// Short cut, using arrayify_string, to allocate buffer and fill with contents of a file.
+// Short cut, using arrayify_map_file, to split the contents of a file.
 int arrayify_file(const char *filepath, arrayify_user_f user,  void *closure);
 
+// Single-pass alternatives that collect the elements in an array
+// that grows on the heap, rather than counting them first.  Return
+// 0 for success, the errno value if they fail.
+int arrayify_string_once(char *buffer, int bufflen, arrayify_user_f user, void *closure);
+int arrayify_file_once(const char *filepath, arrayify_user_f user, void *closure);
+
+// Split a file in a private memory map of the file, used by arrayify_file
+int arrayify_map_file(const char *filepath, arrayify_user_f user, void *closure);
+
+// Split a large buffer in *threads* ranges at once, with the
+// same elements, in the same order, as arrayify_parser()
+int arrayify_string_parallel(char *buffer,
+                             int bufflen,
+                             int threads,
+                             arrayify_user_f user,
+                             void *closure);
+
+// Length of the buffer for reading lines, default 2048
+extern unsigned arrayify_line_bufflen;
+
+// Read a file by lines, calling *user* with the fields of each line,
+// split in place in the read buffer.  Quotes are not recognized, so
+// these return EINVAL if quotes are set (see arrayify_set_quotes()).
+int arrayify_handle_lines(int fh, arrayify_user_f user, void *closure);
+int arrayify_file_lines(const char *filepath, arrayify_user_f user, void *closure);
+
+// Length of the first buffer for streaming, default 64K
+extern unsigned arrayify_stream_bufflen;
+
+// Read elements in chunks, calling *user* with the complete elements
+// of each chunk, with memory for the longest element, not the input.
+int arrayify_handle_stream(int fh, arrayify_user_f user, void *closure);
+int arrayify_file_stream(const char *filepath, arrayify_user_f user, void *closure);
+
+// IFS, quote setting, and escapes compiled for the reentrant
+// functions that end with _r.  A context isn't changed after
+// arrayify_context_init(), so tokenizers with different IFS
+// can run at once, each with its own context, with no shared
+// mutable state.  The functions without _r use a global
+// context built from *arrayify_ifs*, which is not thread-safe.
+typedef struct arrayify_context_s {
+   const char    *ifs;           // IFS string that was compiled
+   int           quotes;         // non-zero to recognize quotes
+   uint64_t      map[4];         // bit for each IFS character
+   uint64_t      special[4];     // bit for each character that ends a run
+   unsigned char lo_nibbles[16]; // SIMD lookup of *special*
+   unsigned char hi_nibbles[16];
+   char          escapes[256];   // character for each escaped character
+} ARRAYIFY_CONTEXT;
+
+// Compile *ifs* (" \t\n" if NULL) and *quotes* into *ctx*.
+// *ifs* must remain valid while *ctx* is used.
+void arrayify_context_init(ARRAYIFY_CONTEXT *ctx, const char *ifs, int quotes);
+
+int arrayify_parser_r(const ARRAYIFY_CONTEXT *ctx,
+                      char *buffer,
+                      int bufflen,
+                      const char **els,
+                      int elslen);
+
+int arrayify_string_r(const ARRAYIFY_CONTEXT *ctx,
+                      char *buffer,
+                      int bufflen,
+                      arrayify_user_f user,
+                      void *closure);
+
+int arrayify_map_file_r(const ARRAYIFY_CONTEXT *ctx,
+                        const char *filepath,
+                        arrayify_user_f user,
+                        void *closure);
+
+int arrayify_string_parallel_r(const ARRAYIFY_CONTEXT *ctx,
+                               char *buffer,
+                               int bufflen,
+                               int threads,
+                               arrayify_user_f user,
+                               void *closure);
+
+// EINVAL if *ctx* has *quotes* set, like arrayify_handle_lines()
+int arrayify_handle_lines_r(const ARRAYIFY_CONTEXT *ctx,
+                            int fh,
+                            arrayify_user_f user,
+                            void *closure);
+
+int arrayify_handle_stream_r(const ARRAYIFY_CONTEXT *ctx,
+                             int fh,
+                             arrayify_user_f user,
+                             void *closure);
+
 #endif
@@ -0,0 +1,566 @@
+/**
+ * @file atoi.c
+ * @brief String-to-integer parsers, the counterparts of itoa.c, with comparisons to strtol.
+ */
+
+#include <errno.h>   // for EINVAL, ERANGE
+#include <string.h>  // for memcpy
+#include <stdint.h>  // for uint64_t
+#include <limits.h>  // for INT_MAX, SHRT_MAX, LONG_MAX, etc
+
+/*******************************************************
+ * Integer-type Settings
+ *
+ * Each of the following sets of 5 statements prepares
+ * the compilation environment to use a specific size of
+ * integer.  Only one of the sets should be active, with
+ * the others being commented-out.
+ *******************************************************/
+
+// typedef short ITYPE;
+// typedef unsigned short UITYPE;
+// #define TYPESPEC "%d"
+// #define ITYPE_MAX SHRT_MAX
+// #define ITYPE_MIN SHRT_MIN
+
+// typedef int ITYPE;
+// typedef unsigned int UITYPE;
+// #define TYPESPEC "%d"
+// #define ITYPE_MAX INT_MAX
+// #define ITYPE_MIN INT_MIN
+
+typedef long ITYPE;
+typedef unsigned long UITYPE;
+#define TYPESPEC "%ld"
+#define ITYPE_MAX LONG_MAX
+#define ITYPE_MIN LONG_MIN
+
+// typedef long long ITYPE;
+// typedef unsigned long long UITYPE;
+// #define TYPESPEC "%lld"
+// #define ITYPE_MAX LLONG_MAX
+// #define ITYPE_MIN LLONG_MIN
+
+/**
+ * @defgroup MainContent
+ * @brief Function group that performs the string-to-integer conversion
+ * @details
+ *    Both parsers read an optional sign followed by digits from a
+ *    string bounded by @b start and @b end, so they work on
+ *    substrings that are not '\0'-terminated, like the lines
+ *    delivered by *read_file_lines*.  Unlike *strtol*, leading
+ *    white space is not skipped.
+ *
+ *    The @b radix argument can be specified from base-2 to base-36,
+ *    with radix specifiers outside of that range reverting to
+ *    base-10.  Letters of either case are accepted as digits above 9.
+ *
+ *    Both return 0 for success, EINVAL if there were no digits, or
+ *    ERANGE if the value would overflow ITYPE, in which case the
+ *    result is clamped to ITYPE_MAX or ITYPE_MIN, as *strtol* does.
+ *    The optional @b stop argument returns the position of the
+ *    first unused character.
+ * @{
+ */
+
+/**
+ * @brief Value of a digit character, or 36 for a non-digit.
+ */
+static inline int atoi_char_value(int chr)
+{
+   if (chr >= '0' && chr <= '9')
+      return chr - '0';
+   else if (chr >= 'A' && chr <= 'Z')
+      return chr - 'A' + 10;
+   else if (chr >= 'a' && chr <= 'z')
+      return chr - 'a' + 10;
+   else
+      return 36;
+}
+
+/**
+ * @brief
+ *    Parse an integer one character at a time, with overflow detection.
+ *
+ * @param start    first character of the string to parse
+ * @param end      pointer just past the last character to consider
+ * @param radix    number base for conversion.  Allowed
+ *                 values from 2 to 36, using base 10
+ *                 for an out-of-range @b radix value.
+ * @param value    [out] converted value
+ * @param stop     [out] optional, set to the first unused character
+ *
+ * @return 0 for success, EINVAL for no digits, ERANGE for overflow
+ */
+int atoi_loop(const char *start,
+              const char *end,
+              int radix,
+              ITYPE *value,
+              const char **stop)
+{
+   if (radix <= 0 || radix > 36)
+      radix = 10;
+
+   const char *ptr = start;
+
+   int negative = 0;
+   if (ptr < end && (*ptr == '-' || *ptr == '+'))
+      negative = (*ptr++ == '-');
+
+   // Magnitude of ITYPE_MIN is one more than ITYPE_MAX:
+   UITYPE limit = negative ? (UITYPE)ITYPE_MAX + 1 : (UITYPE)ITYPE_MAX;
+   UITYPE uvalue = 0;
+
+   const char *first_digit = ptr;
+   int result = 0;
+   int digit;
+
+   while (ptr < end && (digit = atoi_char_value(*ptr)) < radix)
+   {
+      if (uvalue > (limit - digit) / radix)
+      {
+         // Like strtol, consume the remaining digits on overflow
+         while (ptr < end && atoi_char_value(*ptr) < radix)
+            ++ptr;
+
+         uvalue = limit;
+         result = ERANGE;
+         break;
+      }
+
+      uvalue = uvalue * radix + digit;
+      ++ptr;
+   }
+
+   if (ptr == first_digit)
+   {
+      ptr = start;
+      result = EINVAL;
+   }
+
+   // Negate as unsigned to safely produce ITYPE_MIN
+   *value = negative ? (ITYPE)(0 - uvalue) : (ITYPE)uvalue;
+
+   if (stop)
+      *stop = ptr;
+
+   return result;
+}
+
+/*
+ * The SWAR (SIMD within a register) functions treat 8 characters,
+ * loaded into a uint64_t, as 8 one-byte lanes.  They assume a
+ * little-endian layout where the first character is in the least
+ * significant byte.
+ */
+
+/**
+ * @brief
+ *    Count the leading decimal digits in 8 characters after
+ *    replacing each digit with its value.
+ * @param chars    [in,out] 8 characters, returned with '0'
+ *                 subtracted from each byte
+ * @return number of digits, from 0 to 8, before the first non-digit
+ */
+static inline int atoi_swar_count_digits(uint64_t *chars)
+{
+   // Digits become 0x00 to 0x09 in their lanes:
+   uint64_t lanes = *chars ^ UINT64_C(0x3030303030303030);
+   *chars = lanes;
+
+   // A lane is not a digit if its high bit is set before or after
+   // adding 0x76.  A carry can only corrupt lanes following a
+   // non-digit, which are never used.
+   uint64_t nondigits = ((lanes + UINT64_C(0x7676767676767676)) | lanes)
+      & UINT64_C(0x8080808080808080);
+
+   if (nondigits == 0)
+      return 8;
+
+#ifdef __GNUC__
+   return __builtin_ctzll(nondigits) / 8;
+#else
+   int count = 0;
+   while (!(nondigits & 0x80))
+   {
+      nondigits >>= 8;
+      ++count;
+   }
+   return count;
+#endif
+}
+
+/**
+ * @brief Combine 8 lanes of digit values into an integer.
+ * @details
+ *    Three multiplications combine adjacent pairs of lanes, then
+ *    pairs of pairs, then the two halves, rather than the eight
+ *    multiply-and-add steps of a loop.
+ */
+static inline uint32_t atoi_swar_combine(uint64_t lanes)
+{
+   // Pairs of digits into 16-bit lanes:
+   lanes = (lanes * 10) + (lanes >> 8);
+
+   // Pairs of pairs, then the two halves, with one multiplication:
+   lanes = (((lanes & UINT64_C(0x000000FF000000FF)) * (100 + (UINT64_C(1000000) << 32)))
+            + (((lanes >> 16) & UINT64_C(0x000000FF000000FF)) * (1 + (UINT64_C(10000) << 32))))
+      >> 32;
+
+   return (uint32_t)lanes;
+}
+
+/**
+ * @brief
+ *    Parse a decimal integer 8 digits at a time, falling back to
+ *    @ref atoi_loop for other radix values and for the end of the string.
+ *
+ * @details
+ *    While there are at least 8 characters left to read, the
+ *    characters are loaded into a 64-bit integer.  The leading
+ *    digits are counted and combined with a handful of operations,
+ *    whether there are 8 of them or fewer, so a short number like
+ *    "1234" is converted in one step if followed by at least 4
+ *    characters.  A 16-digit number takes two steps.
+ *
+ *    The arguments and return value are the same as for @ref atoi_loop.
+ */
+int atoi_swar(const char *start,
+              const char *end,
+              int radix,
+              ITYPE *value,
+              const char **stop)
+{
+#if defined(__BYTE_ORDER__) && __BYTE_ORDER__ == __ORDER_LITTLE_ENDIAN__
+   static const uint64_t powers[] = {
+      1, 10, 100, 1000, 10000, 100000, 1000000, 10000000, 100000000
+   };
+
+   if (radix <= 0 || radix > 36)
+      radix = 10;
+
+   if (radix == 10)
+   {
+      const char *ptr = start;
+
+      int negative = 0;
+      if (ptr < end && (*ptr == '-' || *ptr == '+'))
+         negative = (*ptr++ == '-');
+
+      uint64_t limit = negative ? (uint64_t)ITYPE_MAX + 1 : (uint64_t)ITYPE_MAX;
+      uint64_t uvalue = 0;
+      const char *first_digit = ptr;
+
+      while (end - ptr >= 8)
+      {
+         uint64_t chars;
+         memcpy(&chars, ptr, sizeof(chars));
+
+         int count = atoi_swar_count_digits(&chars);
+         if (count == 0)
+            break;
+
+         // Shifting out the unwanted lanes leaves leading zeros:
+         uint64_t chunk = atoi_swar_combine(chars << (8 * (8 - count)));
+
+         // Let atoi_loop deal with an overflow
+         if (chunk > limit || uvalue > (limit - chunk) / powers[count])
+            break;
+
+         uvalue = uvalue * powers[count] + chunk;
+         ptr += count;
+
+         if (count < 8)
+         {
+            *value = negative ? (ITYPE)(0 - (UITYPE)uvalue) : (ITYPE)uvalue;
+            if (stop)
+               *stop = ptr;
+            return 0;
+         }
+      }
+
+      if (ptr == first_digit)
+         return atoi_loop(start, end, radix, value, stop);
+
+      // Finish the digits after the last full chunk one at a time.
+      // Leave overflow to atoi_loop, which will parse from the start.
+      int digit;
+      while (ptr < end && (digit = atoi_char_value(*ptr)) < 10)
+      {
+         if (uvalue > (limit - digit) / 10)
+            return atoi_loop(start, end, radix, value, stop);
+
+         uvalue = uvalue * 10 + digit;
+         ++ptr;
+      }
+
+      *value = negative ? (ITYPE)(0 - (UITYPE)uvalue) : (ITYPE)uvalue;
+      if (stop)
+         *stop = ptr;
+
+      return 0;
+   }
+#endif
+
+   return atoi_loop(start, end, radix, value, stop);
+}
+
+/** @} end of MainContent */
+
+
+#ifdef ATOI_MAIN
+
+#define _OPEN_SOURCE 500  // enable snprintf in stdio.h
+#include <stdio.h>
+#ifndef __USE_XOPEN_EXTENDED
+#define __USE_XOPEN_EXTENDED
+#endif
+#include <stdlib.h>    // random, strtol
+#ifndef __USE_POSIX199309
+#define __USE_POSIX199309
+#endif
+#include <time.h>      // for time() to seed random number, timespec
+
+// c_patterns/perftest.c for timing:
+#define PT_INCLUDE_IMPLEMENTATIONS
+#define PT_INCLUDE_RESULTS_REPORT
+#include "perftest.c"
+
+#include <alloca.h>
+
+/**
+ * @defgroup TestingGroups
+ * @brief Confirm results against strtol, then compare performance
+ * @{
+ */
+
+/**
+ * @brief Number strings with the end of each string, to avoid strlen
+ */
+typedef struct num_string {
+   const char *start;
+   const char *end;
+} num_string;
+
+/** Typedef with which @ref run_timed_test runs parse functions */
+typedef ITYPE (*LPARSER)(const num_string *ns);
+
+ITYPE parse_with_strtol(const num_string *ns)
+{
+   return strtol(ns->start, NULL, 10);
+}
+
+ITYPE parse_with_atoi_loop(const num_string *ns)
+{
+   ITYPE value;
+   atoi_loop(ns->start, ns->end, 10, &value, NULL);
+   return value;
+}
+
+ITYPE parse_with_atoi_swar(const num_string *ns)
+{
+   ITYPE value;
+   atoi_swar(ns->start, ns->end, 10, &value, NULL);
+   return value;
+}
+
+/**
+ * @brief Call the function pointer to time parsing each string
+ * @param strs        array of number strings
+ * @param strs_count  number of strings in the array
+ * @param parser      pointer to wrapper function to test
+ */
+void run_timed_test(const num_string *strs, int strs_count, LPARSER parser)
+{
+   const num_string *end = strs + strs_count;
+
+   PT_Gettime_premem pte;
+   PT_Gettime_premem_init(&pte, strs_count + 1);
+
+   PerfTest *pt = (PerfTest*)&pte;
+
+   // Keep the compiler from discarding unused results
+   volatile ITYPE sink;
+
+   PT_add_point(pt, NULL);
+   while (strs < end)
+   {
+      sink = (*parser)(strs);
+      PT_add_point(pt, NULL);
+      ++strs;
+   }
+   (void)sink;
+
+   pt_test_report(pt);
+
+   PT_clean(pt);
+}
+
+int COL_TITLE = 36;
+int COL_METHOD = 34;
+
+void compare_parsing_strategies(const num_string *strs, int len, const char *title)
+{
+   printf("\033[%d;1m%s (%d strings)\033[39;22m\n", COL_TITLE, title, len);
+
+   printf("\nParsing method \033[%d;1m%s\033[39;22m:\n", COL_METHOD, "strtol");
+   run_timed_test(strs, len, parse_with_strtol);
+
+   printf("\nParsing method \033[%d;1m%s\033[39;22m:\n", COL_METHOD, "atoi_loop");
+   run_timed_test(strs, len, parse_with_atoi_loop);
+
+   printf("\nParsing method \033[%d;1m%s\033[39;22m:\n", COL_METHOD, "atoi_swar");
+   run_timed_test(strs, len, parse_with_atoi_swar);
+
+   printf("\n");
+}
+
+/**
+ * @brief
+ *    Fill @b buffer with '\0'-separated number strings and
+ *    index them in @b strs.
+ * @details
+ *    With @b max_digits of 6, the strings resemble the numbers at
+ *    the end of each line of *read_file_lines.test*.  Larger values
+ *    exercise the 8-digit steps.
+ */
+void initialize_number_strings(num_string *strs, int len, char *buffer, int max_digits)
+{
+   char *ptr = buffer;
+   for (int i = 0; i < len; ++i)
+   {
+      int digits = 1 + random() % max_digits;
+      ITYPE value = random() % 9 + 1;
+      while (--digits > 0)
+         value = value * 10 + random() % 10;
+
+      if (random() % 8 == 0)
+         value = -value;
+
+      strs[i].start = ptr;
+      ptr += sprintf(ptr, TYPESPEC, value);
+      strs[i].end = ptr;
+      ++ptr;
+   }
+}
+
+/**
+ * @brief Compare both parsers with strtol for a string in a radix
+ * @return 1 if the results match, 0 if not
+ */
+int confirm_parse(const char *str, int radix)
+{
+   errno = 0;
+   char *strtol_end;
+   ITYPE expected = strtol(str, &strtol_end, radix);
+   int expected_result = errno;
+   if (strtol_end == str)
+      expected_result = EINVAL;
+
+   const char *end = str + strlen(str);
+
+   ITYPE loop_value, swar_value;
+   const char *loop_stop, *swar_stop;
+   int loop_result = atoi_loop(str, end, radix, &loop_value, &loop_stop);
+   int swar_result = atoi_swar(str, end, radix, &swar_value, &swar_stop);
+
+   if (loop_result != expected_result || swar_result != expected_result
+       || loop_stop != strtol_end || swar_stop != strtol_end
+       || (!expected_result && (loop_value != expected || swar_value != expected))
+       || (expected_result == ERANGE && (loop_value != expected || swar_value != expected)))
+   {
+      printf("\033[31;1mMismatch\033[39;22m for \"%s\" radix %d: strtol "
+             TYPESPEC " (%d), loop " TYPESPEC " (%d), swar " TYPESPEC " (%d)\n",
+             str, radix,
+             expected, expected_result,
+             loop_value, loop_result,
+             swar_value, swar_result);
+      return 0;
+   }
+
+   return 1;
+}
+
+void test_against_strtol(void)
+{
+   const char *cases[] = {
+      "0", "7", "-7", "+42", "12345678", "123456789", "1234567890123456",
+      "00000000000000000000000001", "42 is the answer", "3.14159",
+      "9223372036854775807", "9223372036854775808", "-9223372036854775808",
+      "-9223372036854775809", "99999999999999999999999", "-", "+", "",
+      "x", "2147483647", "4294967296", "-0", "7fffffff", "zz", "ZZ"
+   };
+   int radixes[] = { 10, 2, 8, 16, 36 };
+
+   int passed = 0, count = 0;
+
+   for (unsigned r = 0; r < sizeof(radixes) / sizeof(radixes[0]); ++r)
+      for (unsigned c = 0; c < sizeof(cases) / sizeof(cases[0]); ++c, ++count)
+         passed += confirm_parse(cases[c], radixes[r]);
+
+   char buffer[64];
+   for (int i = 0; i < 100000; ++i, ++count)
+   {
+      // Random digit strings of up to 24 digits, some with trailing text
+      int digits = 1 + random() % 24;
+      char *ptr = buffer;
+      if (random() % 4 == 0)
+         *ptr++ = '-';
+      while (digits-- > 0)
+         *ptr++ = '0' + random() % 10;
+      if (random() % 2)
+         *ptr++ = ' ';
+      *ptr = '\0';
+
+      passed += confirm_parse(buffer, 10);
+   }
+
+   printf("Passed %d of %d comparisons with strtol.\n\n", passed, count);
+}
+
+void perform_timing_tests(int argc, const char **argv)
+{
+   int sample_count = 10000;
+   if (argc > 1)
+   {
+      ITYPE sc_arg;
+      if (atoi_swar(argv[1], argv[1] + strlen(argv[1]), 10, &sc_arg, NULL) == 0)
+         sample_count = sc_arg;
+   }
+
+   num_string *strs = (num_string*)malloc(sample_count * sizeof(num_string));
+   char *buffer = (char*)malloc(sample_count * 24);
+   if (strs && buffer)
+   {
+      initialize_number_strings(strs, sample_count, buffer, 6);
+      compare_parsing_strategies(strs, sample_count, "Numbers of up to 6 digits");
+
+      initialize_number_strings(strs, sample_count, buffer, 18);
+      compare_parsing_strategies(strs, sample_count, "Numbers of up to 18 digits");
+   }
+
+   free(buffer);
+   free(strs);
+}
+
+/** @} end of TestingGroups */
+
+int main(int argc, const char **argv)
+{
+   srandom(time(NULL));
+
+   test_against_strtol();
+   perform_timing_tests(argc, argv);
+
+   return 0;
+}
+
+#endif
+
+
+/* Local Variables:                 */
+/* compile-command: "b=atoi;       \*/
+/*   gcc -std=c99 -Wall -Werror    \*/
+/*   -ggdb -fsanitize=address      \*/
+/*   -D${b^^}_MAIN -o $b ${b}.c -lm"*/
+/* End:                             */
@@ -8,6 +8,7 @@
 #include <unistd.h>
 
 #include "columnize.h"
+#include "commaize.h"
 #include "get_keypress.h"
 #include "prompter.h"
 
@@ -33,6 +34,45 @@ CEIF ceif_string = {
    columnize_string_print_cell
 };
 
+/*
+ * Numeric elements point to *long* values, formatted by
+ * commaize_field_format() instead of a printf conversion
+ * specifier.  Change *columnize_long_field* to set the sign
+ * and grouping.  Its width is replaced by the cell width.
+ */
+commaize_field columnize_long_field = { 0, ' ', 0, COMMAIZE_SIGN_NEGATIVE, NULL };
+
+int columnize_long_get_len(const void *el)
+{
+   commaize_field field = columnize_long_field;
+   field.width = 0;
+   return commaize_field_format(*(const long*)el, &field, NULL, 0) - 1;
+}
+
+int columnize_long_print(FILE *f, const void *el)
+{
+   return columnize_long_print_cell(f, el, 0);
+}
+
+/* Right-aligned in the cell, leaving the gutter to the left. */
+int columnize_long_print_cell(FILE *f, const void *el, int width)
+{
+   commaize_field field = columnize_long_field;
+   field.width = width;
+
+   int len = commaize_field_format(*(const long*)el, &field, NULL, 0);
+   char cell[len];
+
+   commaize_field_format(*(const long*)el, &field, cell, len);
+   return (int)fwrite(cell, 1, len - 1, f);
+}
+
+CEIF ceif_long = {
+   columnize_long_get_len,
+   columnize_long_print,
+   columnize_long_print_cell
+};
+
 /*
  * Use simple ioctl function to query the screen size in
  * characters.  Return the dimensions in pointer arguments
@@ -381,11 +421,13 @@ void columnize_print_progress_line(PPARAMS *params, const void **stop)
 #ifdef COLUMNIZE_MAIN
 
 #include "arrayify.c"
+#include "commaize.c"
 #include "get_keypress.c"
 #include "prompter.c"
 
 
 int show_format_demo = 0;
+int show_number_demo = 0;
 int show_screen_specs = 0;
 int max_lines = 0;
 const char *parsing_ifs = "\n";
@@ -447,6 +489,29 @@ void demo_string_formatting(void)
 
 }
 
+/*
+ * Show a table of numbers printed with *ceif_long*, which
+ * pads and aligns the numbers without a printf format string.
+ */
+void demo_numeric_columns(void)
+{
+   long values[40];
+   const void *elements[40];
+   int count = sizeof(values) / sizeof(values[0]);
+
+   long value = 1;
+   for (int i = 0; i < count; ++i)
+   {
+      values[i] = (i % 3) ? value : -value;
+      elements[i] = &values[i];
+      value = value * 2 + i;
+   }
+
+   columnize_long_field.style = &commaize_thousands;
+
+   display_parallel_columns(&ceif_long, elements, elements + count, 2, 0, 0);
+}
+
 /*
  * Code to implement custom *readargs* agents.
  *
@@ -633,6 +698,7 @@ raAction actions[] = {
 
 
    {'d', NULL,      "Show string formatting demo.",              &ra_flag_agent, &show_format_demo},
+   {'N', NULL,      "Show numeric columns demo.",                &ra_flag_agent, &show_number_demo},
    {'S', NULL,      "Show screen specs.",                        &ra_flag_agent, &show_screen_specs},
    {-1,  "*list_start", "First string of list",                  &findarg_agent, &first_string}
 };
@@ -671,6 +737,8 @@ int main(int argc, const char **argv)
 
       if (show_format_demo)
          demo_string_formatting();
+      if (show_number_demo)
+         demo_numeric_columns();
       if (show_screen_specs)
       {
          printf("The screen dimensions are %d columns by %d rows.\n",
@@ -696,7 +764,7 @@ int main(int argc, const char **argv)
 /* compile-command: "b=columnize; \*/
 /*  cc -Wall -Werror -ggdb        \*/
 /*  -std=c99 -pedantic            \*/
-/*  -lreadargs                    \*/
-/*  -D${b^^}_MAIN -o $b ${b}.c"   \*/
+/*  -D${b^^}_MAIN -o $b ${b}.c    \*/
+/*  -lreadargs -lpthread"         \*/
 /* End: */
 
@@ -20,6 +20,11 @@ typedef struct columnize_el_iface {
 // Simple interface for strings.
 extern CEIF ceif_string;
 
+// Interface for elements that point to *long* values, printed
+// right-aligned with commaize_field_format() (see commaize.h).
+extern CEIF ceif_long;
+int columnize_long_print_cell(FILE *f, const void *el, int width);
+
 int columnize_get_max_len(const CEIF *iface, const void **start, const void **end);
 int get_max_string_len(const char **start, const char **end);
 
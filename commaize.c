@@ -1,11 +1,239 @@
+#ifdef COMMAIZE_MAIN
+// Enable clock_gettime() for perftest.c before the first #include
+#define _POSIX_C_SOURCE 200809L
+#endif
+
 #include <stdio.h>
+#include <string.h>    // for memcpy(), strlen()
+
+#include "commaize.h"
+
+/*
+ * Grouping styles for commaize_format().  The *groups* member
+ * follows the convention of the *grouping* member of `struct lconv`
+ * (see `man 3 localeconv`): each char is the size of a group,
+ * starting from the least significant digits, and the last size
+ * repeats for the remaining digits.
+ */
+const commaize_style commaize_thousands = { ",", "\3" };
+const commaize_style commaize_lakh      = { ",", "\3\2" };
+
+/*
+ * Fast itoa core for commaize_format().
+ *
+ * Writes the decimal digits of *num* backwards, two at a time from
+ * a table of digit pairs, ending just before *end*.  Returns a
+ * pointer to the most significant digit.  There must be room for
+ * 20 digits before *end*.
+ */
+static char *commaize_digits(unsigned long num, char *end)
+{
+   static const char pairs[] =
+      "00010203040506070809"
+      "10111213141516171819"
+      "20212223242526272829"
+      "30313233343536373839"
+      "40414243444546474849"
+      "50515253545556575859"
+      "60616263646566676869"
+      "70717273747576777879"
+      "80818283848586878889"
+      "90919293949596979899";
+
+   char *ptr = end;
+
+   while (num >= 100)
+   {
+      const char *pair = pairs + 2 * (num % 100);
+      num /= 100;
+      *--ptr = pair[1];
+      *--ptr = pair[0];
+   }
+
+   if (num >= 10)
+   {
+      const char *pair = pairs + 2 * num;
+      *--ptr = pair[1];
+      *--ptr = pair[0];
+   }
+   else
+      *--ptr = '0' + num;
+
+   return ptr;
+}
+
+/*
+ * Write the *sign* char, unless it is '\0', and the digits of
+ * *magnitude*, with separators between groups of digits, into *buffer*.
+ *
+ * Like itoa_loop() in itoa.c, the return value is always the buffer
+ * length needed for the complete result, including the '\0'
+ * terminator, so calling with a NULL *buffer* measures the result.
+ * If *bufflen* is too short, the result is truncated and terminated.
+ *
+ * A NULL *style* uses commaize_thousands.  No stdio or locale
+ * functions are used.
+ */
+static int commaize_write(char sign,
+                          unsigned long magnitude,
+                          const commaize_style *style,
+                          char *buffer,
+                          int bufflen)
+{
+   if (!style)
+      style = &commaize_thousands;
+
+   char digit_buffer[24];
+   char *digit_end = digit_buffer + sizeof(digit_buffer);
+   const char *digits = commaize_digits(magnitude, digit_end);
+   int digits_count = (int)(digit_end - digits);
+
+   const char *separator = style->separator ? style->separator : "";
+   int sep_len = (int)strlen(separator);
+
+   // Collect group sizes from the right, then count the separators:
+   const char *group = style->groups ? style->groups : "";
+   int group_size = (*group > 0) ? *group : 0;
+   int sizes[24];
+   int sizes_count = 0;
+   int remaining = digits_count;
+
+   while (group_size && remaining > group_size)
+   {
+      sizes[sizes_count++] = group_size;
+      remaining -= group_size;
+
+      // The last size in *groups* repeats
+      if (*(group+1) > 0)
+         group_size = *++group;
+   }
+   sizes[sizes_count++] = remaining;
+
+   int required_length = (sign != 0) + digits_count + (sizes_count - 1) * sep_len + 1;
+
+   if (buffer && bufflen > 0)
+   {
+      char *ptr = buffer;
+      char *end = buffer + bufflen - 1;
+
+      if (sign && ptr < end)
+         *ptr++ = sign;
+
+      // Copy the groups from the most significant, the last size found:
+      for (int index = sizes_count - 1; index >= 0 && ptr < end; --index)
+      {
+         int len = sizes[index];
+         if (len > end - ptr)
+            len = (int)(end - ptr);
+
+         memcpy(ptr, digits, len);
+         ptr += len;
+         digits += len;
+
+         if (index > 0)
+         {
+            len = sep_len;
+            if (len > end - ptr)
+               len = (int)(end - ptr);
+
+            memcpy(ptr, separator, len);
+            ptr += len;
+         }
+      }
+
+      *ptr = '\0';
+   }
+
+   return required_length;
+}
+
+/*
+ * Write *num* with separators between groups of digits into *buffer*.
+ * See commaize_write() for the return value and buffer handling.
+ */
+int commaize_format(long num, const commaize_style *style, char *buffer, int bufflen)
+{
+   int negative = num < 0;
+
+   // Negate as unsigned to safely convert LONG_MIN
+   unsigned long magnitude = negative ? -(unsigned long)num : (unsigned long)num;
+
+   return commaize_write(negative ? '-' : 0, magnitude, style, buffer, bufflen);
+}
+
+/*
+ * Write *num* into a field of at least *field->width* chars, padded
+ * with spaces or zeros, with the sign and grouping set by *field*.
+ * A number wider than the field is not truncated, as with printf.
+ *
+ * The return value and buffer handling are the same as for
+ * commaize_format().  To append fields to a line, advance the line
+ * pointer by one less than the return value, overwriting the '\0'
+ * with the next field.
+ */
+int commaize_field_format(long num, const commaize_field *field, char *buffer, int bufflen)
+{
+   static const commaize_style no_grouping = { NULL, NULL };
+   const commaize_style *style = field->style ? field->style : &no_grouping;
+
+   int negative = num < 0;
+   unsigned long magnitude = negative ? -(unsigned long)num : (unsigned long)num;
+
+   char sign = 0;
+   if (negative)
+      sign = '-';
+   else if (field->sign == COMMAIZE_SIGN_ALWAYS)
+      sign = '+';
+   else if (field->sign == COMMAIZE_SIGN_SPACE)
+      sign = ' ';
+
+   int body_len = commaize_write(sign, magnitude, style, NULL, 0) - 1;
+   int padding = field->width > body_len ? field->width - body_len : 0;
+   int required_length = body_len + padding + 1;
+
+   if (buffer && bufflen > 0)
+   {
+      char *ptr = buffer;
+      char *end = buffer + bufflen - 1;
+
+      if (field->align_left)
+      {
+         ptr += commaize_write(sign, magnitude, style, ptr, end - ptr + 1) - 1;
+         if (ptr > end)
+            ptr = end;
+         while (ptr < end && padding-- > 0)
+            *ptr++ = ' ';
+      }
+      else
+      {
+         // Zeros go between the sign and the digits
+         if (field->pad == '0' && sign)
+         {
+            if (ptr < end)
+               *ptr++ = sign;
+            sign = 0;
+         }
+
+         char pad = field->pad == '0' ? '0' : ' ';
+         while (ptr < end && padding-- > 0)
+            *ptr++ = pad;
+
+         commaize_write(sign, magnitude, style, ptr, end - ptr + 1);
+         return required_length;
+      }
+
+      *ptr = '\0';
+   }
+
+   return required_length;
+}
 
 /**
  * Add commas to printout of integer values.
  *
- * Using recursion to read from the end to the beginning
- * of the number to properly break into 1000s, then print
- * each 3-digit portion when the recursion unwinds.
+ * This used to recurse once for each group of 3 digits, calling
+ * printf for each group as the recursion unwound.  Now it formats
+ * the number with commaize_format() and prints the result once.
  *
  * The same thing can be done with *setlocale* and *printf*
  * using a format specifier with an apostrophe:
@@ -17,21 +245,26 @@
  */
 void commaize_number(unsigned long num)
 {
+   // The recursive version printed nothing for 0:
    if (num > 0)
    {
-      // recurse to reverse order
-      commaize_number(num / 1000);
-
-      if (num >= 1000)
-         printf(",%03lu", num % 1000);
-      else
-         printf("%lu", num);
+      char buffer[COMMAIZE_BUFFLEN];
+      commaize_write(0, num, NULL, buffer, sizeof(buffer));
+      fputs(buffer, stdout);
    }
 }
 
 
 #ifdef COMMAIZE_MAIN
 
+#include <locale.h>
+#include <limits.h>    // for LONG_MAX, LONG_MIN
+
+// c_patterns/perftest.c for timing:
+#define PT_INCLUDE_IMPLEMENTATIONS
+#define PT_INCLUDE_RESULTS_REPORT
+#include "perftest.c"
+
 void test(unsigned long num)
 {
    printf("%7lu: ", num);
@@ -39,13 +272,125 @@ void test(unsigned long num)
    printf("\n");
 }
 
+void test_style(long num, const commaize_style *style, const char *name)
+{
+   char buffer[COMMAIZE_BUFFLEN];
+   int len = commaize_format(num, style, buffer, sizeof(buffer));
+   printf("%20ld %-10s (%2d): %s\n", num, name, len, buffer);
+}
+
+/*
+ * Time *count* conversions of each value by snprintf with the
+ * apostrophe flag, then by commaize_format.
+ */
+void compare_with_printf(const long *values, int count)
+{
+   // Keep the flag in a variable to silence the -pedantic
+   // objection to the non-ISO apostrophe flag.
+   const char *format = "%'ld";
+   char buffer[COMMAIZE_BUFFLEN];
+   const long *end = values + count;
+   const long *ptr;
+
+   // Copy the locale name, which the next setlocale() may overwrite
+   char old_locale[64];
+   snprintf(old_locale, sizeof(old_locale), "%s", setlocale(LC_NUMERIC, NULL));
+   setlocale(LC_NUMERIC, "");
+
+   snprintf(buffer, sizeof(buffer), format, 1234567L);
+   printf("\nsnprintf(\"%%'ld\") in locale \"%s\" formats 1234567 as %s\n",
+          setlocale(LC_NUMERIC, NULL), buffer);
+
+   PT_Gettime_premem pte;
+   PerfTest *pt = (PerfTest*)&pte;
+
+   printf("\nFormat method \033[34;1msnprintf with %%'ld\033[39;22m:\n");
+   PT_Gettime_premem_init(&pte, count + 1);
+   PT_add_point(pt, NULL);
+   for (ptr = values; ptr < end; ++ptr)
+   {
+      snprintf(buffer, sizeof(buffer), format, *ptr);
+      PT_add_point(pt, NULL);
+   }
+   pt_test_report(pt);
+   PT_clean(pt);
+
+   setlocale(LC_NUMERIC, old_locale);
+
+   printf("\nFormat method \033[34;1mcommaize_format\033[39;22m:\n");
+   PT_Gettime_premem_init(&pte, count + 1);
+   PT_add_point(pt, NULL);
+   for (ptr = values; ptr < end; ++ptr)
+   {
+      commaize_format(*ptr, NULL, buffer, sizeof(buffer));
+      PT_add_point(pt, NULL);
+   }
+   pt_test_report(pt);
+   PT_clean(pt);
+}
+
 int main(int argc, const char **argv)
 {
    test(100);
    test(1000);
    test(10000);
    test(100000);
-   
+   test((unsigned long)-1);
+
+   const commaize_style swiss = { "'", "\3" };
+   const commaize_style spaced = { " ", "\3" };
+
+   printf("\n");
+   test_style(0, NULL, "default");
+   test_style(-1234567, NULL, "default");
+   test_style(LONG_MAX, &commaize_thousands, "thousands");
+   test_style(LONG_MIN, &commaize_thousands, "thousands");
+   test_style(123456789, &commaize_lakh, "lakh");
+   test_style(-10000000, &commaize_lakh, "lakh");
+   test_style(123456789, &swiss, "swiss");
+   test_style(123456789, &spaced, "spaced");
+
+   const commaize_field fields[] = {
+      {  8, ' ', 0, COMMAIZE_SIGN_NEGATIVE, NULL },
+      {  8, '0', 0, COMMAIZE_SIGN_NEGATIVE, NULL },
+      {  8, ' ', 1, COMMAIZE_SIGN_ALWAYS,   NULL },
+      {  8, ' ', 0, COMMAIZE_SIGN_SPACE,    NULL },
+      { 12, ' ', 0, COMMAIZE_SIGN_NEGATIVE, &commaize_thousands }
+   };
+   const char *field_names[] = {
+      "width 8", "zero-padded", "left, plus sign", "space sign", "grouped"
+   };
+   const long field_values[] = { 42, -42, 1234567 };
+
+   // Build each line with fields rather than with printf:
+   printf("\n");
+   for (unsigned f = 0; f < sizeof(fields) / sizeof(fields[0]); ++f)
+   {
+      char line[COMMAIZE_BUFFLEN];
+      char *ptr = line;
+      char *end = line + sizeof(line);
+      for (unsigned v = 0; v < sizeof(field_values) / sizeof(field_values[0]); ++v)
+      {
+         *ptr++ = '|';
+         ptr += commaize_field_format(field_values[v], &fields[f], ptr, end - ptr) - 1;
+      }
+      *ptr++ = '|';
+      *ptr = '\0';
+
+      printf("%-16s %s\n", field_names[f], line);
+   }
+
+   enum { SAMPLES = 10000 };
+   static long values[SAMPLES];
+   unsigned long seed = 12345;
+   for (int i = 0; i < SAMPLES; ++i)
+   {
+      seed = seed * 6364136223846793005UL + 1442695040888963407UL;
+      values[i] = (long)(seed >> (1 + seed % 48));
+   }
+
+   compare_with_printf(values, SAMPLES);
+
    return 0;
 }
 
@@ -58,5 +403,5 @@ int main(int argc, const char **argv)
 /* compile-command: "b=commaize; \*/
 /*  cc -Wall -Werror -ggdb        \*/
 /*  -std=c99 -pedantic            \*/
-/*  -D${b^^}_MAIN -o $b ${b}.c"   \*/
+/*  -D${b^^}_MAIN -o $b ${b}.c -lm" \*/
 /* End: */
@@ -1,4 +1,46 @@
 #ifndef COMMAIZE_H
+#define COMMAIZE_H
+
+// Buffer length that holds any commaize_format() result
+// with separators of up to 3 bytes (e.g. a UTF-8 thin space).
+#define COMMAIZE_BUFFLEN 80
+
+/*
+ * Separator string and group sizes for commaize_format().
+ * *groups* is a string of group sizes, least significant first,
+ * with the last size repeating, like `struct lconv` *grouping*.
+ */
+typedef struct commaize_style {
+   const char *separator;
+   const char *groups;
+} commaize_style;
+
+// "1,234,567"
+extern const commaize_style commaize_thousands;
+// Indian lakh/crore grouping, "12,34,567"
+extern const commaize_style commaize_lakh;
+
+int commaize_format(long num, const commaize_style *style, char *buffer, int bufflen);
+
+typedef enum commaize_sign {
+   COMMAIZE_SIGN_NEGATIVE = 0,  // '-' for negative values only
+   COMMAIZE_SIGN_ALWAYS,        // '+' or '-'
+   COMMAIZE_SIGN_SPACE          // ' ' or '-'
+} commaize_sign;
+
+/*
+ * Field layout for commaize_field_format(), like the printf
+ * flags and field width, but without parsing a format string.
+ */
+typedef struct commaize_field {
+   int                  width;       // minimum number of chars
+   char                 pad;         // ' ' or '0', ignored when left-aligned
+   int                  align_left;  // non-zero to pad on the right
+   commaize_sign        sign;        // sign for non-negative values
+   const commaize_style *style;      // grouping, or NULL for none
+} commaize_field;
+
+int commaize_field_format(long num, const commaize_field *field, char *buffer, int bufflen);
 
 void commaize_number(unsigned long num);
 
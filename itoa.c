@@ -6,6 +6,9 @@
 #include <assert.h>
 #include <string.h>  // for strncpy
 #include <limits.h>  // for INT_MAX, SHRT_MAX, LONG_MAX, etc
+#include <stdint.h>  // for uint64_t in dtoa_shortest
+
+#include "dtoa_pow10.h"
 
 /*******************************************************
  * Integer-type Settings
@@ -339,8 +342,413 @@ const char *itoa_instant(ITYPE value, int radix)
    return cur_digit + 1;
 }
 
+/**
+ * @brief Number of @ref itoa_instant_r results that remain valid at once.
+ * @details
+ *    Must be a power of 2 so the ring index can be masked rather
+ *    than divided.  Override with -DITOA_RING_COUNT=n when compiling.
+ */
+#ifndef ITOA_RING_COUNT
+#define ITOA_RING_COUNT 8
+#endif
+
+#if (ITOA_RING_COUNT & (ITOA_RING_COUNT - 1)) != 0
+#error ITOA_RING_COUNT must be a power of 2
+#endif
+
+#if defined(__STDC_VERSION__) && __STDC_VERSION__ >= 201112L
+#define ITOA_THREAD_LOCAL _Thread_local
+#else
+#define ITOA_THREAD_LOCAL __thread
+#endif
+
+/**
+ * @brief
+ *    Thread-safe version of @ref itoa_instant using a per-thread ring of buffers
+ *
+ * @details
+ *    Like @ref itoa_instant, the digits are written backwards into a
+ *    buffer that is never measured, allocated, or copied.  The
+ *    difference is that each thread owns a ring of
+ *    @ref ITOA_RING_COUNT buffers, and each call moves to the next
+ *    buffer in the ring.
+ *
+ *    The result is valid until the same thread has made another
+ *    @ref ITOA_RING_COUNT calls, so several conversions can be used
+ *    as arguments to a single printf call, and worker threads never
+ *    overwrite each other's results.
+ *
+ * @param value    integer value to be converted to a string
+ * @param radix    number base for conversion.  Allowed
+ *                 values from 2 to 36, using base 10
+ *                 for an out-of-range @b radix value.
+ *
+ * @return pointer to the converted string in the thread's ring
+ */
+const char *itoa_instant_r(ITYPE value, int radix)
+{
+   // Thread-local storage is zero-initialized and the final char
+   // of each buffer is never written, so every result is terminated.
+   static ITOA_THREAD_LOCAL char ring[ITOA_RING_COUNT][2 + sizeof(ITYPE)*8];
+   static ITOA_THREAD_LOCAL unsigned ring_index = 0;
+
+   char *buffer = ring[ring_index];
+   ring_index = (ring_index + 1) & (ITOA_RING_COUNT - 1);
+
+   // Start left of the terminating '\0' in the last position:
+   char *cur_digit = buffer + sizeof(ring[0]) - 2;
+
+   if (radix <= 0 || radix > 36)
+      radix = 10;
+
+   if (value == 0)
+      *cur_digit-- = '0';
+   else
+   {
+      int negative = value < 0;
+
+      // Negate as unsigned to safely convert ITYPE_MIN
+      UITYPE uvalue = negative ? -(UITYPE)value : (UITYPE)value;
+
+      while (uvalue > 0)
+      {
+         assert(cur_digit >= buffer);
+         char cval = uvalue % radix;
+         if (cval < 10)
+            cval += '0';
+         else
+            cval += ('A' - 10);
+
+         *cur_digit-- = cval;
+         uvalue /= radix;
+      }
+
+      if (negative)
+         *cur_digit-- = '-';
+   }
+
+   return cur_digit + 1;
+}
+
 /** @} end of MainContent */
 
+/**
+ * @defgroup FloatContent
+ * @brief Function group that converts a double to its shortest string
+ * @details
+ *    @ref dtoa_shortest writes the fewest digits that convert back
+ *    to exactly the same double, using the Schubfach algorithm by
+ *    Raffaello Giulietti.  Each conversion takes a few 128-bit
+ *    multiplications against an entry of the powers-of-ten table in
+ *    *dtoa_pow10.h*, with no loops over digit candidates, no
+ *    big-integer arithmetic, and no library functions.
+ *
+ *    The output always satisfies *isJsonNumber* for finite values,
+ *    so it can be used directly for JSON output.
+ * @{
+ */
+
+/** @brief Buffer length that holds any @ref dtoa_shortest result. */
+#define DTOA_BUFFLEN 32
+
+#ifdef __SIZEOF_INT128__
+__extension__ typedef unsigned __int128 dtoa_uint128;
+
+/** @brief High 64 bits of the 128-bit product of @b a and @b b */
+static inline uint64_t dtoa_mul_hi(uint64_t a, uint64_t b, uint64_t *lo)
+{
+   dtoa_uint128 product = (dtoa_uint128)a * b;
+   *lo = (uint64_t)product;
+   return (uint64_t)(product >> 64);
+}
+#else
+static inline uint64_t dtoa_mul_hi(uint64_t a, uint64_t b, uint64_t *lo)
+{
+   uint64_t a_lo = (uint32_t)a, a_hi = a >> 32;
+   uint64_t b_lo = (uint32_t)b, b_hi = b >> 32;
+
+   uint64_t lo_lo = a_lo * b_lo;
+   uint64_t hi_lo = a_hi * b_lo;
+   uint64_t lo_hi = a_lo * b_hi;
+   uint64_t hi_hi = a_hi * b_hi;
+
+   uint64_t cross = (lo_lo >> 32) + (uint32_t)hi_lo + lo_hi;
+
+   *lo = (cross << 32) | (uint32_t)lo_lo;
+   return hi_hi + (hi_lo >> 32) + (cross >> 32);
+}
+#endif
+
+/**
+ * @brief
+ *    Multiply a 128-bit power of ten by @b cp, keeping the high
+ *    64 bits with a sticky bit for the discarded remainder.
+ */
+static inline uint64_t dtoa_round_to_odd(const uint64_t *g, uint64_t cp)
+{
+   uint64_t x_lo, y_lo;
+   uint64_t x_hi = dtoa_mul_hi(g[1], cp, &x_lo);
+   uint64_t y_hi = dtoa_mul_hi(g[0], cp, &y_lo);
+
+   // Add the carry of the low product into the high product
+   y_lo += x_hi;
+   if (y_lo < x_hi)
+      ++y_hi;
+
+   return y_hi | (y_lo > 1);
+}
+
+/**
+ * @brief
+ *    Find the shortest decimal significand and exponent of a
+ *    finite, positive double.
+ * @details
+ *    The result satisfies `value == *digits * 10^*exponent` after
+ *    rounding back to the nearest double, and no decimal with fewer
+ *    digits does.  @b digits may have trailing zeros.
+ *
+ * @param bits      IEEE-754 bits of the value, sign bit cleared
+ * @param digits    [out] decimal significand
+ * @param exponent  [out] power of ten to apply to @b digits
+ */
+static void dtoa_decimal(uint64_t bits, uint64_t *digits, int *exponent)
+{
+   uint64_t fraction = bits & ((UINT64_C(1) << 52) - 1);
+   int biased_exp = (int)(bits >> 52);
+
+   uint64_t c;
+   int q;
+   if (biased_exp != 0)
+   {
+      c = fraction | (UINT64_C(1) << 52);
+      q = biased_exp - 1075;
+
+      // Small integers need no rounding interval
+      if (q <= 0 && q > -53 && (c & ((UINT64_C(1) << -q) - 1)) == 0)
+      {
+         *digits = c >> -q;
+         *exponent = 0;
+         return;
+      }
+   }
+   else
+   {
+      // subnormal
+      c = fraction;
+      q = 1 - 1075;
+   }
+
+   int is_even = (c % 2 == 0);
+   int lower_is_closer = (fraction == 0 && biased_exp > 1);
+
+   // Rounding interval [cbl, cbr] around cb, all scaled by 4
+   uint64_t cbl = 4 * c - 2 + lower_is_closer;
+   uint64_t cb  = 4 * c;
+   uint64_t cbr = 4 * c + 2;
+
+   // k = floor(log10(2^q)), or floor(log10(3/4 * 2^q)) if lower is closer.
+   // The right shift of a negative product must floor, as it does with gcc.
+   int k = (q * 1262611 - (lower_is_closer ? 524031 : 0)) >> 22;
+
+   // h = q + floor(log2(10^-k)) + 1, from 1 to 4
+   int h = q + ((-k * 1741647) >> 19) + 1;
+
+   const uint64_t *g = dtoa_pow10_table[-k - DTOA_POW10_MIN];
+   uint64_t vbl = dtoa_round_to_odd(g, cbl << h);
+   uint64_t vb  = dtoa_round_to_odd(g, cb  << h);
+   uint64_t vbr = dtoa_round_to_odd(g, cbr << h);
+
+   // Round-half-even: interval bounds belong to even significands
+   uint64_t lower = vbl + !is_even;
+   uint64_t upper = vbr - !is_even;
+
+   uint64_t s = vb / 4;
+
+   // Try one digit fewer first
+   if (s >= 10)
+   {
+      uint64_t sp = s / 10;
+      int up_inside = lower <= 40 * sp;
+      int wp_inside = 40 * sp + 40 <= upper;
+      if (up_inside != wp_inside)
+      {
+         *digits = sp + wp_inside;
+         *exponent = k + 1;
+         return;
+      }
+   }
+
+   int u_inside = lower <= 4 * s;
+   int w_inside = 4 * s + 4 <= upper;
+   if (u_inside != w_inside)
+   {
+      *digits = s + w_inside;
+      *exponent = k;
+      return;
+   }
+
+   // Both or neither candidate inside: choose the closer, ties to even
+   uint64_t mid = 4 * s + 2;
+   int round_up = vb > mid || (vb == mid && (s & 1) != 0);
+
+   *digits = s + round_up;
+   *exponent = k;
+}
+
+/**
+ * @brief Write the shortest round-trip string of a double.
+ * @details
+ *    The digits are arranged the way JavaScript prints a number:
+ *    plain notation when the decimal point falls within 21 digits
+ *    of the first digit and no more than 6 places to its left,
+ *    scientific notation (`1.5e+300`, `5e-324`) otherwise.
+ *
+ *    Non-finite values are written as `nan`, `inf`, or `-inf`, as
+ *    printf("%g") does, although JSON has no representation for them.
+ *
+ *    Like @ref itoa_loop, this function always returns the buffer
+ *    length needed for the conversion, including the '\0'
+ *    terminator, whether or not the conversion is completed.  Call
+ *    with a NULL @b buffer to measure, or with a buffer of
+ *    @ref DTOA_BUFFLEN chars to skip the measuring.  A too-short
+ *    buffer is filled with the truncated, terminated string.
+ *
+ * @param value    double value to be converted to a string
+ * @param buffer   buffer to which output should be written
+ * @param bufflen  length of @b buffer in bytes
+ *
+ * @return the number of characters needed to fully express @b value,
+ *         including the terminating '\0'
+ */
+int dtoa_shortest(double value, char *buffer, int bufflen)
+{
+   char work_buffer[DTOA_BUFFLEN];
+   char *ptr = work_buffer;
+
+   uint64_t bits;
+   memcpy(&bits, &value, sizeof(bits));
+
+   if (bits >> 63)
+      *ptr++ = '-';
+   bits &= ~(UINT64_C(1) << 63);
+
+   if ((bits >> 52) == 0x7FF)
+   {
+      if (bits & ((UINT64_C(1) << 52) - 1))
+      {
+         ptr = work_buffer;
+         memcpy(ptr, "nan", 3);
+      }
+      else
+         memcpy(ptr, "inf", 3);
+      ptr += 3;
+   }
+   else if (bits == 0)
+      *ptr++ = '0';
+   else
+   {
+      uint64_t digits;
+      int exponent;
+      dtoa_decimal(bits, &digits, &exponent);
+
+      while (digits % 10 == 0)
+      {
+         digits /= 10;
+         ++exponent;
+      }
+
+      // Write the digits backwards into a scratch area
+      char digit_buffer[20];
+      char *digit_end = digit_buffer + sizeof(digit_buffer);
+      char *first_digit = digit_end;
+      while (digits > 0)
+      {
+         *--first_digit = '0' + digits % 10;
+         digits /= 10;
+      }
+
+      int count = (int)(digit_end - first_digit);
+
+      // Position of the decimal point relative to the first digit:
+      int point = count + exponent;
+
+      if (count <= point && point <= 21)
+      {
+         // integer: digits followed by zeros
+         memcpy(ptr, first_digit, count);
+         ptr += count;
+         memset(ptr, '0', point - count);
+         ptr += point - count;
+      }
+      else if (0 < point && point <= 21)
+      {
+         // decimal point among the digits
+         memcpy(ptr, first_digit, point);
+         ptr += point;
+         *ptr++ = '.';
+         memcpy(ptr, first_digit + point, count - point);
+         ptr += count - point;
+      }
+      else if (-6 < point && point <= 0)
+      {
+         // leading zeros after the decimal point
+         *ptr++ = '0';
+         *ptr++ = '.';
+         memset(ptr, '0', -point);
+         ptr += -point;
+         memcpy(ptr, first_digit, count);
+         ptr += count;
+      }
+      else
+      {
+         // scientific notation
+         *ptr++ = *first_digit;
+         if (count > 1)
+         {
+            *ptr++ = '.';
+            memcpy(ptr, first_digit + 1, count - 1);
+            ptr += count - 1;
+         }
+
+         int sci_exp = point - 1;
+         *ptr++ = 'e';
+         if (sci_exp < 0)
+         {
+            *ptr++ = '-';
+            sci_exp = -sci_exp;
+         }
+         else
+            *ptr++ = '+';
+
+         if (sci_exp >= 100)
+         {
+            *ptr++ = '0' + sci_exp / 100;
+            sci_exp %= 100;
+            *ptr++ = '0' + sci_exp / 10;
+         }
+         else if (sci_exp >= 10)
+            *ptr++ = '0' + sci_exp / 10;
+         *ptr++ = '0' + sci_exp % 10;
+      }
+   }
+
+   *ptr = '\0';
+
+   int required_length = (int)(ptr - work_buffer) + 1;
+
+   // Bufflen must be at least 1 to contain the NULL terminator
+   if (buffer && bufflen > 0)
+   {
+      int copy_len = required_length < bufflen ? required_length : bufflen;
+      memcpy(buffer, work_buffer, copy_len);
+      buffer[copy_len - 1] = '\0';
+   }
+
+   return required_length;
+}
+
+/** @} end of FloatContent */
+
 // The include statements here are only needed for the testing
 // functions that follow.
 
@@ -364,6 +772,8 @@ const char *itoa_instant(ITYPE value, int radix)
 #include <stdbool.h>
 #include <alloca.h>
 #include <locale.h>
+#include <pthread.h>   // for thread scaling test
+#include <unistd.h>    // for sysconf()
 
 
 /**
@@ -437,6 +847,15 @@ void convert_with_itoa_instant(ITYPE value)
    itoa_instant(value, 10);
 }
 
+/**
+ * @brief Wrapper around thread-safe conversion function to a thread-local ring
+ * @param value   value to convert
+ */
+void convert_with_itoa_instant_r(ITYPE value)
+{
+   itoa_instant_r(value, 10);
+}
+
 /**
  * @brief Wrapper to use itoa_instant to copy to new string buffer.
  * @details
@@ -538,6 +957,11 @@ void compare_conversion_strategies(ITYPE *lvals, int len)
           "itoa_instant");
    run_timed_test(lvals, len, convert_with_itoa_instant);
 
+   printf("\nConversion method \033[%d;1m%s\033[39;22m:\n",
+          COL_METHOD,
+          "itoa_instant_r");
+   run_timed_test(lvals, len, convert_with_itoa_instant_r);
+
    printf("\nConversion method \033[%d;1m%s\033[39;22m:\n",
           COL_METHOD,
           "itoa_instant_copy");
@@ -549,6 +973,243 @@ void compare_conversion_strategies(ITYPE *lvals, int len)
 /** @} end of group Method_NewMemory */
 
 
+/**
+ * @ingroup TestingGroups
+ * @defgroup Method_Doubles
+ * @brief Compare double-to-string conversions
+ * @details
+ *    Like @ref Method_NewMemory, each conversion measures and
+ *    allocates memory for its result.  `%g` is included because it
+ *    is the usual choice, though its 6 significant digits do not
+ *    survive a round trip.  `%.17g` always survives a round trip,
+ *    but usually with more digits than necessary.
+ * @{
+ */
+
+/** Typedef with which @ref run_timed_double_test runs convert functions */
+typedef void (*DPRINTER)(double value);
+
+/**
+ * @brief Wrapper around double-to-string conversion using snprintf "%g"
+ * @param value   value to convert
+ */
+void convert_double_with_snprintf_g(double value)
+{
+   int len = snprintf(NULL, 0, "%g", value) + 1;
+   char *buff = (char*)alloca(len);
+
+   snprintf(buff, len, "%g", value);
+}
+
+/**
+ * @brief Wrapper around round-trip double-to-string conversion using snprintf "%.17g"
+ * @param value   value to convert
+ */
+void convert_double_with_snprintf_17g(double value)
+{
+   int len = snprintf(NULL, 0, "%.17g", value) + 1;
+   char *buff = (char*)alloca(len);
+
+   snprintf(buff, len, "%.17g", value);
+}
+
+/**
+ * @brief Wrapper around shortest round-trip conversion with dtoa_shortest
+ * @param value   value to convert
+ */
+void convert_double_with_dtoa_shortest(double value)
+{
+   int len = dtoa_shortest(value, NULL, 0);
+   char *buff = (char*)alloca(len);
+
+   dtoa_shortest(value, buff, len);
+}
+
+/**
+ * @brief Wrapper around dtoa_shortest to a buffer of guaranteed size
+ * @param value   value to convert
+ */
+void convert_double_with_dtoa_shortest_nomeasure(double value)
+{
+   char buff[DTOA_BUFFLEN];
+   dtoa_shortest(value, buff, sizeof(buff));
+}
+
+/**
+ * @brief Call the function pointer to time the conversion of each double
+ * @param dvals       array of double values
+ * @param vals_count  number of double values in the array
+ * @param prntr       pointer to wrapper function to test
+ */
+void run_timed_double_test(const double *dvals, int vals_count, DPRINTER prntr)
+{
+   const double *end = dvals + vals_count;
+
+   PT_Gettime_premem pte;
+   PT_Gettime_premem_init(&pte, vals_count + 1);
+
+   PerfTest *pt = (PerfTest*)&pte;
+
+   PT_add_point(pt, NULL);
+   while (dvals < end)
+   {
+      (*prntr)(*dvals);
+      PT_add_point(pt, NULL);
+      ++dvals;
+   }
+
+   pt_test_report(pt);
+
+   PT_clean(pt);
+}
+
+/**
+ * @brief
+ *    Calls each of the double conversion timer functions with the
+ *    same set of double values.
+ * @param  dvals    array of double values to test with each timer function
+ * @param  len      number of double values in the @b dvals array
+ */
+void compare_double_conversion_strategies(const double *dvals, int len)
+{
+   printf("\n\033[%d;1m"
+          "Display by-method timings for a set of "
+          "\033[%d;1m"
+          "%d"
+          "\033[%d;1m"
+          " double values"
+          "\033[39;22m\n",
+          COL_TITLE, COL_VALUE, len, COL_TITLE);
+
+   printf("\nConversion method \033[%d;1m%s\033[39;22m:\n",
+          COL_METHOD,
+          "snprintf %g");
+   run_timed_double_test(dvals, len, convert_double_with_snprintf_g);
+
+   printf("\nConversion method \033[%d;1m%s\033[39;22m:\n",
+          COL_METHOD,
+          "snprintf %.17g");
+   run_timed_double_test(dvals, len, convert_double_with_snprintf_17g);
+
+   printf("\nConversion method \033[%d;1m%s\033[39;22m:\n",
+          COL_METHOD,
+          "dtoa_shortest");
+   run_timed_double_test(dvals, len, convert_double_with_dtoa_shortest);
+
+   printf("\nConversion method \033[%d;1m%s\033[39;22m:\n",
+          COL_METHOD,
+          "dtoa_shortest_nomeasure");
+   run_timed_double_test(dvals, len, convert_double_with_dtoa_shortest_nomeasure);
+}
+
+/** @} end of group Method_Doubles */
+
+
+/**
+ * @ingroup TestingGroups
+ * @defgroup Method_Threads
+ * @brief Multithreaded throughput of the thread-safe conversion
+ * @details
+ *    Each thread converts the entire set of values several times
+ *    with @ref itoa_instant_r.  Since the threads share no mutable
+ *    state, the total conversions per second should increase in
+ *    proportion to the number of threads, up to the number of cores.
+ * @{
+ */
+
+/** Number of times each thread converts the entire set of values. */
+int THREAD_ROUNDS = 20;
+
+/** Work order and result for a single benchmark thread */
+typedef struct thread_job {
+   const ITYPE *lvals;   ///< shared, read-only array of values to convert
+   int         count;    ///< number of values in @b lvals
+   long        sink;     ///< accumulated result to prevent optimizing away the work
+} thread_job;
+
+/**
+ * @brief Thread function that converts every value THREAD_ROUNDS times.
+ * @param data   pointer to a @ref thread_job
+ */
+void *thread_convert_values(void *data)
+{
+   thread_job *job = (thread_job*)data;
+   const ITYPE *end = job->lvals + job->count;
+   long sink = 0;
+
+   for (int round = 0; round < THREAD_ROUNDS; ++round)
+      for (const ITYPE *ptr = job->lvals; ptr < end; ++ptr)
+         sink += *itoa_instant_r(*ptr, 10);
+
+   job->sink = sink;
+   return NULL;
+}
+
+/**
+ * @brief Elapsed nanoseconds running @b thread_count threads at once
+ * @param lvals         array of values shared by all threads
+ * @param len           number of values in @b lvals
+ * @param thread_count  number of threads to start
+ * @return number of nanoseconds from starting to joining all threads
+ */
+long time_thread_conversions(const ITYPE *lvals, int len, int thread_count)
+{
+   pthread_t threads[thread_count];
+   thread_job jobs[thread_count];
+
+   struct timespec ts_start, ts_end;
+   clock_gettime(CLOCK_MONOTONIC, &ts_start);
+
+   for (int i = 0; i < thread_count; ++i)
+   {
+      jobs[i] = (thread_job){ lvals, len, 0 };
+      pthread_create(&threads[i], NULL, thread_convert_values, &jobs[i]);
+   }
+
+   for (int i = 0; i < thread_count; ++i)
+      pthread_join(threads[i], NULL);
+
+   clock_gettime(CLOCK_MONOTONIC, &ts_end);
+
+   return (ts_end.tv_sec - ts_start.tv_sec) * 1000000000L
+      + (ts_end.tv_nsec - ts_start.tv_nsec);
+}
+
+/**
+ * @brief
+ *    Report throughput of @ref itoa_instant_r from one thread up
+ *    to twice the number of online processors.
+ * @param  lvals    array of ITYPE values for each thread to convert
+ * @param  len      number of ITYPE values in the @b lvals array
+ */
+void compare_thread_scaling(const ITYPE *lvals, int len)
+{
+   long cores = sysconf(_SC_NPROCESSORS_ONLN);
+   if (cores < 1)
+      cores = 1;
+
+   printf("\n\033[%d;1m"
+          "Thread scaling of itoa_instant_r on %ld online processors"
+          "\033[39;22m\n",
+          COL_TITLE, cores);
+
+   printf("  threads  conversions/sec   scaling\n");
+
+   double single_rate = 0.0;
+   for (int threads = 1; threads <= cores * 2; threads *= 2)
+   {
+      long nsecs = time_thread_conversions(lvals, len, threads);
+      double rate = (double)len * THREAD_ROUNDS * threads * 1e9 / nsecs;
+      if (threads == 1)
+         single_rate = rate;
+
+      printf("  %7d  %15.0f  %7.2fx\n", threads, rate, rate / single_rate);
+   }
+}
+
+/** @} end of group Method_Threads */
+
+
 /**
  * @defgroup BaseTesting
  * @define Easily perform a battery of tests to confirm proper radix handling.
@@ -576,11 +1237,14 @@ void print_with_itoa_radix(ITYPE value, int radix)
       printf("   radix \033[34;1m%2d\033[39;22m required %2d chars, results by method\n"
              "      recursion: %s\n"
              "           loop: %s\n"
-             "        instant: %s\n",
+             "        instant: %s\n"
+             "      instant_r: %s (value/radix: %s)\n",
              radix, len,
              recurse_buffer,
              loop_buffer,
-             itoa_instant(value, radix));
+             itoa_instant(value, radix),
+             itoa_instant_r(value, radix),
+             itoa_instant_r(value / radix, radix));
    }
 }
 
@@ -631,6 +1295,24 @@ void initialize_array_of_integers(ITYPE *longs, int len)
       *longs = random();
 }
 
+/**
+ * @brief Populate an array of doubles with random values
+ * @details
+ *    Mixes values with few decimal places, like prices and
+ *    measurements typical of JSON, with values whose shortest
+ *    representation needs many digits.
+ */
+void initialize_array_of_doubles(double *doubles, int len)
+{
+   for (int i=0; i<len; ++i, doubles++)
+   {
+      if (i % 2)
+         *doubles = (double)random() / 100.0;
+      else
+         *doubles = (double)random() / (double)(random() | 1);
+   }
+}
+
 void display_max_buffer_explanation(void)
 {
    printf("\033[1mExplain calculation of maximum required buffer size.\033[22m\n");
@@ -658,6 +1340,16 @@ void perform_timing_tests(int argc, const char **argv)
       initialize_array_of_integers(lvalues, sample_count);
 
       compare_conversion_strategies(lvalues, sample_count);
+
+      compare_thread_scaling(lvalues, sample_count);
+   }
+
+   double *dvalues = (double*)alloca(sample_count * sizeof(double));
+   if (dvalues)
+   {
+      initialize_array_of_doubles(dvalues, sample_count);
+
+      compare_double_conversion_strategies(dvalues, sample_count);
    }
 }
 
@@ -680,6 +1372,6 @@ int main(int argc, const char **argv)
 /* compile-command: "gcc           \*/
 /*   -std=c99 -Wall -Werror -ggdb  \*/
 /*   -fsanitize=address            \*/
-/*   -lm                           \*/
+/*   -lpthread -lm                 \*/
 /*   -o itoa itoa.c"                */
 /* End:                             */
@@ -0,0 +1,499 @@
+// Enable madvise() under -std=c99
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <stdio.h>     // for FILE functions in save and load
+#include <stdlib.h>    // for realloc(), free()
+#include <string.h>    // for memset()
+#include <errno.h>
+
+#include <sys/types.h>
+#include <sys/stat.h>
+#include <sys/mman.h>  // for mmap(), madvise()
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "line_index.h"
+
+// Sidecar file name is the indexed file's name with this suffix
+#define LINE_INDEX_SUFFIX ".lidx"
+
+// Sidecar file starts with these bytes, followed by a version byte
+static const char line_index_magic[4] = { 'L', 'I', 'D', 'X' };
+#define LINE_INDEX_VERSION 2
+
+/**
+ * Add an offset to the index, doubling the array when it's full.
+ * Returns 0 for success, ENOMEM if the array can't grow.
+ */
+static int line_index_add(LINE_INDEX *index, uint64_t *capacity, uint64_t offset)
+{
+   if (index->count == *capacity)
+   {
+      uint64_t new_capacity = *capacity ? *capacity * 2 : 1024;
+      uint64_t *newoffsets = (uint64_t*)realloc(index->offsets, new_capacity * sizeof(uint64_t));
+      if (!newoffsets)
+         return ENOMEM;
+
+      index->offsets = newoffsets;
+      *capacity = new_capacity;
+   }
+
+   index->offsets[index->count++] = offset;
+   return 0;
+}
+
+/**
+ * Make an index of the lines of a file in one pass of the line
+ * scanner over a memory map of the file.  Lines end like they do
+ * for *read_file_lines*, so the index numbers the same lines that
+ * *read_file_lines* delivers.
+ *
+ * With *interval* 1, every line is recorded.  A larger *interval*
+ * makes a sparse index that records every *interval*th line, and
+ * reaching the lines in between takes a short scan.
+ *
+ * Returns 0 for success, the errno value if it fails, including
+ * ESPIPE if *filepath* is not a regular file.
+ */
+int line_index_build(const char *filepath, unsigned interval, LINE_INDEX *index)
+{
+   struct stat st;
+   int errnum = 0;
+
+   memset(index, 0, sizeof(LINE_INDEX));
+
+   if (interval == 0)
+      return EINVAL;
+
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      return errno;
+
+   if (fstat(fh, &st))
+   {
+      errnum = errno;
+      goto abandon_file;
+   }
+
+   if (!S_ISREG(st.st_mode))
+   {
+      errnum = ESPIPE;
+      goto abandon_file;
+   }
+
+   index->interval = interval;
+   index->file_size = (uint64_t)st.st_size;
+   index->file_mtime = (int64_t)st.st_mtim.tv_sec;
+   index->file_mtime_nsec = (uint32_t)st.st_mtim.tv_nsec;
+
+   if (st.st_size == 0)
+      goto abandon_file;
+
+   size_t map_len = (size_t)st.st_size;
+   const char *map = (const char*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fh, 0);
+   if (map == (const char*)MAP_FAILED)
+   {
+      errnum = errno;
+      goto abandon_file;
+   }
+
+   madvise((void*)map, map_len, MADV_SEQUENTIAL);
+
+   const char *end = map + map_len;
+   const char *ptr = map;
+   uint64_t capacity = 0;
+   uint64_t lines = 0;
+   unsigned countdown = 1;    // lines until the next recorded line
+
+   while (ptr < end)
+   {
+      if (--countdown == 0)
+      {
+         if ((errnum = line_index_add(index, &capacity, (uint64_t)(ptr - map))))
+            break;
+         countdown = interval;
+      }
+
+      ++lines;
+
+      ptr = find_line_end(ptr, end);
+      if (ptr < end && *ptr++ == '\r' && ptr < end && *ptr == '\n')
+         ++ptr;
+   }
+
+   index->lines = lines;
+
+   munmap((void*)map, map_len);
+
+  abandon_file:
+   close(fh);
+
+   if (errnum)
+      line_index_free(index);
+
+   return errnum;
+}
+
+void line_index_free(LINE_INDEX *index)
+{
+   free(index->offsets);
+   memset(index, 0, sizeof(LINE_INDEX));
+}
+
+/**
+ * Write *value* in 7-bit groups, least significant first,
+ * with the high bit set on every byte but the last.
+ */
+static void line_index_put_varint(FILE *f, uint64_t value)
+{
+   while (value >= 0x80)
+   {
+      putc((int)(value & 0x7f) | 0x80, f);
+      value >>= 7;
+   }
+   putc((int)value, f);
+}
+
+/**
+ * Returns 0 for success, -1 for a truncated or invalid value.
+ */
+static int line_index_get_varint(FILE *f, uint64_t *value)
+{
+   uint64_t result = 0;
+   int shift = 0;
+   int byte;
+
+   do
+   {
+      if (shift > 63 || (byte = getc(f)) == EOF)
+         return -1;
+
+      result |= (uint64_t)(byte & 0x7f) << shift;
+      shift += 7;
+   }
+   while (byte & 0x80);
+
+   *value = result;
+   return 0;
+}
+
+/**
+ * Save an index to a file, storing each offset as the
+ * difference from the previous offset in a variable-length
+ * integer, usually one or two bytes per line.  The file is
+ * written under a temporary name and renamed when complete.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int line_index_save(const LINE_INDEX *index, const char *idxpath)
+{
+   size_t path_len = strlen(idxpath);
+   char tmppath[path_len + 5];
+   memcpy(tmppath, idxpath, path_len);
+   memcpy(tmppath + path_len, ".tmp", 5);
+
+   FILE *f = fopen(tmppath, "wb");
+   if (!f)
+      return errno;
+
+   fwrite(line_index_magic, 1, sizeof(line_index_magic), f);
+   putc(LINE_INDEX_VERSION, f);
+
+   line_index_put_varint(f, index->interval);
+   line_index_put_varint(f, index->lines);
+   line_index_put_varint(f, index->count);
+   line_index_put_varint(f, index->file_size);
+   line_index_put_varint(f, (uint64_t)index->file_mtime);
+   line_index_put_varint(f, index->file_mtime_nsec);
+
+   uint64_t previous = 0;
+   for (uint64_t i = 0; i < index->count; ++i)
+   {
+      line_index_put_varint(f, index->offsets[i] - previous);
+      previous = index->offsets[i];
+   }
+
+   int errnum = ferror(f) ? EIO : 0;
+   if (fclose(f) && !errnum)
+      errnum = errno;
+
+   if (!errnum && rename(tmppath, idxpath))
+      errnum = errno;
+
+   if (errnum)
+      remove(tmppath);
+
+   return errnum;
+}
+
+/**
+ * Load an index saved by *line_index_save*, restoring the
+ * offsets to an array for constant-time access.
+ *
+ * The sidecar may be damaged or written by something else, so
+ * it must be consistent: one entry per *interval* lines, no
+ * more lines than bytes, and offsets that start at 0, never
+ * decrease, and don't pass the end of the file.
+ *
+ * Returns 0 for success, the errno value if it fails, including
+ * EILSEQ if the file is not a valid index.
+ */
+int line_index_load(const char *idxpath, LINE_INDEX *index)
+{
+   char magic[sizeof(line_index_magic)];
+   uint64_t interval, mtime, mtime_nsec;
+   int errnum = 0;
+
+   memset(index, 0, sizeof(LINE_INDEX));
+
+   FILE *f = fopen(idxpath, "rb");
+   if (!f)
+      return errno;
+
+   if (fread(magic, 1, sizeof(magic), f) != sizeof(magic)
+       || memcmp(magic, line_index_magic, sizeof(magic))
+       || getc(f) != LINE_INDEX_VERSION
+       || line_index_get_varint(f, &interval)
+       || line_index_get_varint(f, &index->lines)
+       || line_index_get_varint(f, &index->count)
+       || line_index_get_varint(f, &index->file_size)
+       || line_index_get_varint(f, &mtime)
+       || line_index_get_varint(f, &mtime_nsec)
+       || interval == 0 || interval > 0xffffffffu
+       || mtime_nsec >= 1000000000u
+       || index->lines > index->file_size
+       || index->count != index->lines / interval + (index->lines % interval != 0)
+       || index->count > SIZE_MAX / sizeof(uint64_t))
+   {
+      errnum = EILSEQ;
+      goto abandon_file;
+   }
+
+   index->interval = (unsigned)interval;
+   index->file_mtime = (int64_t)mtime;
+   index->file_mtime_nsec = (uint32_t)mtime_nsec;
+
+   if (index->count)
+   {
+      index->offsets = (uint64_t*)malloc(index->count * sizeof(uint64_t));
+      if (!index->offsets)
+      {
+         errnum = ENOMEM;
+         goto abandon_file;
+      }
+
+      uint64_t offset = 0, delta;
+      for (uint64_t i = 0; i < index->count; ++i)
+      {
+         // A delta past the file size also catches a wrapped offset
+         if (line_index_get_varint(f, &delta)
+             || (i == 0 && delta != 0)
+             || delta > index->file_size - offset)
+         {
+            errnum = EILSEQ;
+            goto abandon_file;
+         }
+         offset += delta;
+         index->offsets[i] = offset;
+      }
+   }
+
+  abandon_file:
+   fclose(f);
+
+   if (errnum)
+      line_index_free(index);
+
+   return errnum;
+}
+
+/**
+ * Use the sidecar index of a file if it was made with the same
+ * *interval* from the file at its current size and modification
+ * time, to the nanosecond, so a file rewritten at the same size
+ * within a second isn't read with a stale index.  Otherwise, build
+ * the index and try to save it, though failure to save it, as in a
+ * read-only directory, is not an error.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int line_index_open(const char *filepath, unsigned interval, LINE_INDEX *index)
+{
+   struct stat st;
+   if (stat(filepath, &st))
+      return errno;
+
+   size_t path_len = strlen(filepath);
+   char idxpath[path_len + sizeof(LINE_INDEX_SUFFIX)];
+   memcpy(idxpath, filepath, path_len);
+   memcpy(idxpath + path_len, LINE_INDEX_SUFFIX, sizeof(LINE_INDEX_SUFFIX));
+
+   if (!line_index_load(idxpath, index))
+   {
+      if (index->interval == interval
+          && index->file_size == (uint64_t)st.st_size
+          && index->file_mtime == (int64_t)st.st_mtim.tv_sec
+          && index->file_mtime_nsec == (uint32_t)st.st_mtim.tv_nsec)
+         return 0;
+
+      line_index_free(index);
+   }
+
+   int errnum = line_index_build(filepath, interval, index);
+   if (!errnum)
+      line_index_save(index, idxpath);
+
+   return errnum;
+}
+
+typedef struct line_index_range_s {
+   uint64_t    skip;       // lines to pass before the first requested line
+   uint64_t    remaining;  // requested lines not yet delivered
+   line_user_f user;
+   void        *closure;
+} LINE_INDEX_RANGE;
+
+static rfl_bool line_index_range_user(const char *start, const char *end, void *closure)
+{
+   LINE_INDEX_RANGE *range = (LINE_INDEX_RANGE*)closure;
+
+   if (range->skip)
+   {
+      --range->skip;
+      return 1;
+   }
+
+   return (*range->user)(start, end, range->closure) && --range->remaining > 0;
+}
+
+/**
+ * Deliver *count* lines, starting with line *first* (counting from 0),
+ * from the file open on *fh*.  The indexed line at or before *first*
+ * is found in constant time, and reading begins there, so at most
+ * *interval*-1 lines are scanned before the first requested line.
+ * Like line_index_build(), it accepts lines of any length: a line
+ * that doesn't fit in RFL_bufflen is read into a heap buffer that
+ * grows to hold it.
+ *
+ * Returns 0 for success, the errno value if it fails, or EINVAL
+ * if *index* has no entry for *first*.
+ */
+int line_index_read_lines(const LINE_INDEX *index,
+                          int fh,
+                          uint64_t first,
+                          uint64_t count,
+                          line_user_f user,
+                          void *closure)
+{
+   if (first >= index->lines || count == 0)
+      return 0;
+
+   uint64_t entry = first / index->interval;
+   if (entry >= index->count)
+      return EINVAL;
+
+   LINE_INDEX_RANGE range = { first % index->interval, count, user, closure };
+
+   if (lseek(fh, (off_t)index->offsets[entry], SEEK_SET) == -1)
+      return errno;
+
+   return read_handle_long_lines(fh, SIZE_MAX, line_index_range_user, NULL, &range);
+}
+
+
+#ifdef LINE_INDEX_MAIN
+
+#include <time.h>      // for clock_gettime()
+
+rfl_bool line_index_print(const char *start, const char *end, void *closure)
+{
+   printf("%6llu: %.*s\n",
+          (unsigned long long)(*(uint64_t*)closure)++,
+          (int)(end - start), start);
+   return 1;
+}
+
+double line_index_elapsed(const struct timespec *ts_start)
+{
+   struct timespec ts_end;
+   clock_gettime(CLOCK_MONOTONIC, &ts_end);
+   return (ts_end.tv_sec - ts_start->tv_sec) * 1000.0
+      + (ts_end.tv_nsec - ts_start->tv_nsec) / 1e6;
+}
+
+/**
+ * Usage: line_index [-k interval] file [first [count]]
+ *
+ * Opens (making if necessary) the index of *file*, then
+ * prints *count* lines starting with line *first*.
+ */
+int main(int argc, const char **argv)
+{
+   unsigned interval = 1;
+   const char *filepath = NULL;
+   uint64_t first = 0, count = 10;
+   int position = 0;
+
+   for (int i = 1; i < argc; ++i)
+   {
+      if (!strcmp(argv[i], "-k") && i + 1 < argc)
+         interval = (unsigned)strtoul(argv[++i], NULL, 10);
+      else if (position == 0)
+         filepath = argv[i], ++position;
+      else if (position == 1)
+         first = strtoull(argv[i], NULL, 10), ++position;
+      else
+         count = strtoull(argv[i], NULL, 10);
+   }
+
+   if (!filepath)
+   {
+      printf("Usage: line_index [-k interval] file [first [count]]\n");
+      return 1;
+   }
+
+   LINE_INDEX index;
+   struct timespec ts_start;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts_start);
+   int errnum = line_index_open(filepath, interval, &index);
+   if (errnum)
+   {
+      printf("Failed to index \"%s\" (%s).\n", filepath, strerror(errnum));
+      return 1;
+   }
+
+   printf("Index of %llu lines, %llu entries, opened in %.3f ms.\n",
+          (unsigned long long)index.lines,
+          (unsigned long long)index.count,
+          line_index_elapsed(&ts_start));
+
+   int fh = open(filepath, O_RDONLY);
+   if (fh != -1)
+   {
+      uint64_t line_number = first;
+
+      clock_gettime(CLOCK_MONOTONIC, &ts_start);
+      errnum = line_index_read_lines(&index, fh, first, count, line_index_print, &line_number);
+      printf("Read lines in %.3f ms.\n", line_index_elapsed(&ts_start));
+
+      close(fh);
+   }
+
+   line_index_free(&index);
+
+   return errnum;
+}
+
+#endif
+
+
+/* Local Variables: */
+/* compile-command: "b=line_index; \*/
+/*  cc -Wall -Werror -ggdb          \*/
+/*  -std=c99 -pedantic              \*/
+/*  -D${b^^}_MAIN -o $b ${b}.c      \*/
+/*  read_file_lines.c -lpthread"    \*/
+/* End: */
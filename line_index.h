@@ -0,0 +1,35 @@
+#ifndef LINE_INDEX_H
+#define LINE_INDEX_H
+
+#include <stdint.h>           // for uint64_t
+#include "read_file_lines.h"  // for line_user_f
+
+// Offsets of the lines of a file, either every line, or, in
+// a sparse index, every *interval*th line.
+typedef struct line_index_s {
+   uint64_t *offsets;     // offsets[i] is the start of line i * interval
+   uint64_t count;        // number of elements in *offsets*
+   uint64_t lines;        // number of lines in the file
+   uint64_t file_size;    // size of the file when indexed
+   int64_t  file_mtime;   // modification time (seconds) when indexed
+   uint32_t file_mtime_nsec;  // nanoseconds of the modification time
+   unsigned interval;     // 1 for every line
+} LINE_INDEX;
+
+int line_index_build(const char *filepath, unsigned interval, LINE_INDEX *index);
+int line_index_save(const LINE_INDEX *index, const char *idxpath);
+int line_index_load(const char *idxpath, LINE_INDEX *index);
+void line_index_free(LINE_INDEX *index);
+
+// Load the sidecar index *filepath*.lidx if it matches the file,
+// otherwise build a new index and save it to the sidecar.
+int line_index_open(const char *filepath, unsigned interval, LINE_INDEX *index);
+
+int line_index_read_lines(const LINE_INDEX *index,
+                          int fh,
+                          uint64_t first,
+                          uint64_t count,
+                          line_user_f user,
+                          void *closure);
+
+#endif
@@ -1,117 +1,2058 @@
 
-#include <string.h>    // for memcpy()
+// Enable madvise(), pthreads, syscall(), and, for the timing demo, clock_gettime()
+#ifndef _DEFAULT_SOURCE
+#define _DEFAULT_SOURCE
+#endif
+
+#include <string.h>    // for memmove()
+#include <stdlib.h>    // for malloc(), realloc()
+#include <stdint.h>    // for SIZE_MAX
+
+#include <sys/types.h> // for open()
+#include <sys/stat.h>
+#include <fcntl.h>
+#include <sys/mman.h>  // for mmap(), madvise()
+#include <pthread.h>   // for parallel chunks
+
+#include <unistd.h>    // for read()
+#include <errno.h>     // for strerror()
+
+// Define RFL_NO_URING to use only the helper thread for async reading
+#if defined(__linux__) && !defined(RFL_NO_URING)
+#include <sys/syscall.h>
+#include <sys/uio.h>       // for struct iovec
+#include <linux/io_uring.h>
+#define RFL_URING
+#endif
+
+#ifdef __linux__
+#include <sys/inotify.h>   // for follow_file_lines()
+#include <poll.h>
+#endif
+
+#ifdef RFL_GZIP
+#include <zlib.h>
+#endif
+
+#ifdef RFL_ZSTD
+#include <zstd.h>
+#endif
+
+// Define RFL_NO_SIMD to compare with the byte-at-a-time scan
+#ifndef RFL_NO_SIMD
+#if defined(__AVX2__)
+#include <immintrin.h>
+#elif defined(__SSE2__)
+#include <emmintrin.h>
+#endif
+#endif
+
+#include "read_file_lines.h"
+
+
+unsigned RFL_bufflen = 2048;
+
+#if !defined(RFL_NO_SIMD) && defined(__AVX2__)
+#define RFL_SIMD_WIDTH 32
+#elif !defined(RFL_NO_SIMD) && defined(__SSE2__)
+#define RFL_SIMD_WIDTH 16
+#endif
+
+#ifdef RFL_SIMD_WIDTH
+/**
+ * Compares RFL_SIMD_WIDTH bytes at *ptr* to '\r' and '\n' at once,
+ * returning a bit mask in which bit *n* is set if ptr[n] is either.
+ */
+static inline unsigned rfl_eol_mask(const char *ptr)
+{
+#if RFL_SIMD_WIDTH == 32
+   __m256i chunk = _mm256_loadu_si256((const __m256i*)ptr);
+   return (unsigned)_mm256_movemask_epi8(
+      _mm256_or_si256(_mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\n')),
+                      _mm256_cmpeq_epi8(chunk, _mm256_set1_epi8('\r'))));
+#else
+   __m128i chunk = _mm_loadu_si128((const __m128i*)ptr);
+   return (unsigned)_mm_movemask_epi8(
+      _mm_or_si128(_mm_cmpeq_epi8(chunk, _mm_set1_epi8('\n')),
+                   _mm_cmpeq_epi8(chunk, _mm_set1_epi8('\r'))));
+#endif
+}
+#endif
+
+/**
+ * Returns a pointer to the first '\r' or '\n' in [ptr, end),
+ * or *end* if there are none.
+ *
+ * With SSE2 or AVX2, 16 or 32 bytes are compared to both
+ * characters at once, and the lowest set bit of the mask
+ * marks the terminator.
+ */
+static inline const char *rfl_find_eol(const char *ptr, const char *end)
+{
+#ifdef RFL_SIMD_WIDTH
+   while (end - ptr >= RFL_SIMD_WIDTH)
+   {
+      unsigned mask = rfl_eol_mask(ptr);
+      if (mask)
+         return ptr + __builtin_ctz(mask);
+      ptr += RFL_SIMD_WIDTH;
+   }
+#endif
+
+   while (ptr < end && *ptr != '\n' && *ptr != '\r')
+      ++ptr;
+
+   return ptr;
+}
+
+/**
+ * Public access to the terminator search for modules,
+ * like *line_index.c*, that scan lines on their own.
+ */
+const char *find_line_end(const char *ptr, const char *end)
+{
+   return rfl_find_eol(ptr, end);
+}
+
+/**
+ * Deliver each complete line in a block of text to *user*.
+ *
+ * The current line begins at *start_line*, and the terminator
+ * search begins at *scan_from*, so the beginning of a partial
+ * line carried over from the previous block is not searched again.
+ *
+ * A '\r', a '\n', or a "\r\n" pair ends a line.  If the block ends
+ * with '\r', *skip_lf* is set so a '\n' at *scan_from* in the next
+ * block is recognized as the second half of the pair.
+ *
+ * Returns a pointer to the beginning of the incomplete line at the
+ * end of the block (*end* if there is none), or NULL if *user*
+ * returned 0 to stop reading.
+ */
+static const char *rfl_scan_lines(const char *start_line,
+                                  const char *scan_from,
+                                  const char *end,
+                                  int *skip_lf,
+                                  line_user_f user,
+                                  void *closure)
+{
+   const char *ptr = scan_from;
+
+   if (*skip_lf && ptr < end)
+   {
+      if (*ptr == '\n')
+         start_line = ++ptr;
+      *skip_lf = 0;
+   }
+
+   while ((ptr = rfl_find_eol(ptr, end)) < end)
+   {
+      const char *end_line = ptr;
+
+      if (*ptr++ == '\r')
+      {
+         if (ptr == end)
+            *skip_lf = 1;
+         else if (*ptr == '\n')
+            ++ptr;
+      }
+
+      if (!(*user)(start_line, end_line, closure))
+         return NULL;
+
+      start_line = ptr;
+   }
+
+   return start_line;
+}
+
+/*
+ * A source of bytes for *rfl_read_lines*: a file handle, possibly
+ * through a decompressor.  Bytes read to identify the format of
+ * the file are kept in *in* to be used before reading *fh* again.
+ */
+typedef struct rfl_source_s RFL_SOURCE;
+
+typedef ssize_t (*rfl_source_read_f)(RFL_SOURCE *source, char *buffer, size_t len);
+
+struct rfl_source_s {
+   int               fh;
+   rfl_source_read_f read;
+   unsigned char     *in;       // input not yet used, compressed if decompressing
+   size_t            in_size;   // allocated length of *in*
+   size_t            in_pos;    // first unused byte in *in*
+   size_t            in_end;    // end of the data in *in*
+   int               in_eof;    // set when read() on *fh* returns 0
+   int               ended;     // set if the compressed stream is complete
+   void              *state;    // decompressor state
+};
+
+/**
+ * Read the uncompressed bytes of a file, starting
+ * with any bytes left in *in*.  Sets errno on failure.
+ */
+static ssize_t rfl_source_fd(RFL_SOURCE *source, char *buffer, size_t len)
+{
+   if (source->in_pos < source->in_end)
+   {
+      size_t avail = source->in_end - source->in_pos;
+      if (len > avail)
+         len = avail;
+      memcpy(buffer, source->in + source->in_pos, len);
+      source->in_pos += len;
+      return (ssize_t)len;
+   }
+
+   return read(source->fh, buffer, len);
+}
+
+/**
+ * Read lines from *source* into *buffer*, which may be replaced with
+ * a heap buffer, doubling in size, to hold a line that doesn't fit,
+ * until the buffer length reaches *max_len*.
+ *
+ * If a line fills the *max_len* bytes, those bytes are passed to
+ * *overflow*.  If *overflow* returns non-zero, the rest of
+ * the line is skipped and reading continues with the next line.
+ * Otherwise, including when *overflow* is NULL, reading stops and
+ * the function returns EOVERFLOW.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+static int rfl_read_lines(RFL_SOURCE *source,
+                          char *buffer,
+                          size_t bufflen,
+                          size_t max_len,
+                          line_user_f user,
+                          line_overflow_f overflow,
+                          void *closure)
+{
+   char *heap = NULL;           // replaces *buffer* when the buffer grows
+   char *buffend = buffer + bufflen;
+
+   char *start_read = buffer;   // memory position at which next read begins
+   char *end_read;              // points to memory position limit of most recent read
+
+   const char *start_line;      // beginning of the incomplete line after a read
+   const char *scan_from;       // where to search for the next line ending
+   int skip_lf = 0;             // set if the last read ended with '\r'
+   int discarding = 0;          // set while skipping the rest of an overflowing line
+   int errnum = 0;
+
+   ssize_t bytes_read;
+
+   for (;;)
+   {
+      // An incomplete line fills the buffer
+      if (start_read == buffend)
+      {
+         size_t len = buffend - buffer;
+         if (len < max_len)
+         {
+            size_t newlen = len > max_len / 2 ? max_len : len * 2;
+            char *newbuff = heap ? realloc(heap, newlen) : malloc(newlen);
+            if (!newbuff)
+            {
+               errnum = ENOMEM;
+               goto abandon_function;
+            }
+
+            if (!heap)
+               memcpy(newbuff, buffer, len);
+
+            heap = buffer = newbuff;
+            buffend = buffer + newlen;
+            start_read = buffer + len;
+         }
+         else if (overflow && (*overflow)(buffer, buffend, closure))
+         {
+            discarding = 1;
+            start_read = buffer;
+         }
+         else
+         {
+            errnum = EOVERFLOW;
+            goto abandon_function;
+         }
+      }
+
+      bytes_read = (*source->read)(source, start_read, buffend-start_read);
+      if (bytes_read <= 0)
+         break;
+
+      // Keep track of the end of the data
+      end_read = start_read + bytes_read;
+
+      // All scans start at the beginning of a line
+      start_line = buffer;
+      scan_from = start_read;
+
+      // Drop bytes up to the end of an overflowing line
+      if (discarding)
+      {
+         const char *eol = rfl_find_eol(start_read, end_read);
+         if (eol == end_read)
+         {
+            start_read = buffer;
+            continue;
+         }
+
+         discarding = 0;
+         if (*eol++ == '\r')
+         {
+            if (eol == end_read)
+               skip_lf = 1;
+            else if (*eol == '\n')
+               ++eol;
+         }
+         start_line = scan_from = eol;
+      }
+
+      start_line = rfl_scan_lines(start_line, scan_from, end_read, &skip_lf, user, closure);
+      if (!start_line)
+         goto abandon_function;
+
+      // Prepare pointers for loop to next read():
+
+      // measure length of the incomplete line
+      size_t move_bytes = end_read - start_line;
+
+      // copy incomplete line beginning of the buffer
+      if (move_bytes && start_line > buffer)
+         memmove(buffer, start_line, move_bytes);
+
+      // prepare to read file to byte following incomplete line
+      start_read = buffer + move_bytes;
+   }
+
+   if (bytes_read == -1)
+      errnum = errno;
+   else if (start_read > buffer && !discarding)
+      (*user)(buffer, start_read, closure);
+
+  abandon_function:
+   free(heap);
+   return errnum;
+}
+
+/**
+ * Returns 0 for success, the errno value if it fails.
+ * A line longer than RFL_bufflen stops reading and returns
+ * EOVERFLOW.  Use *read_handle_long_lines* for longer lines.
+ */
+int read_handle_lines(int fh, line_user_f user, void *closure)
+{
+   RFL_SOURCE source = { fh, rfl_source_fd };
+   char buffer[RFL_bufflen];
+   return rfl_read_lines(&source, buffer, sizeof(buffer), sizeof(buffer), user, NULL, closure);
+}
+
+/**
+ * Like *read_handle_lines*, except lines shorter than *max_len* bytes
+ * are accommodated by moving to a larger, heap-allocated buffer when
+ * a line doesn't fit in RFL_bufflen.  Longer lines are reported
+ * to *overflow* (see *rfl_read_lines*).
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int read_handle_long_lines(int fh,
+                           size_t max_len,
+                           line_user_f user,
+                           line_overflow_f overflow,
+                           void *closure)
+{
+   if (max_len == 0)
+      return EINVAL;
+
+   RFL_SOURCE source = { fh, rfl_source_fd };
+   size_t bufflen = RFL_bufflen < max_len ? RFL_bufflen : max_len;
+   char buffer[bufflen];
+   return rfl_read_lines(&source, buffer, bufflen, max_len, user, overflow, closure);
+}
+
+int read_file_long_lines(const char *filepath,
+                         size_t max_len,
+                         line_user_f user,
+                         line_overflow_f overflow,
+                         void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = read_handle_long_lines(fh, max_len, user, overflow, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/**
+ * Returns a pointer to the last '\r' or '\n' in [start, ptr),
+ * or NULL if there are none.  The SIMD version uses the highest
+ * set bit of each mask, working back from *ptr*.
+ */
+static inline const char *rfl_find_eol_reverse(const char *start, const char *ptr)
+{
+#ifdef RFL_SIMD_WIDTH
+   while (ptr - start >= RFL_SIMD_WIDTH)
+   {
+      ptr -= RFL_SIMD_WIDTH;
+      unsigned mask = rfl_eol_mask(ptr);
+      if (mask)
+         return ptr + (31 - __builtin_clz(mask));
+   }
+#endif
+
+   while (ptr > start)
+   {
+      --ptr;
+      if (*ptr == '\n' || *ptr == '\r')
+         return ptr;
+   }
+
+   return NULL;
+}
+
+/**
+ * Fill [buffer, buffer+len) from *offset* in *fh*.  Returns
+ * 0 for success, the errno value if it fails, or EIO if
+ * the file is shorter than expected.
+ */
+static int rfl_pread_all(int fh, char *buffer, size_t len, off_t offset)
+{
+   while (len > 0)
+   {
+      ssize_t bytes_read = pread(fh, buffer, len, offset);
+      if (bytes_read == -1)
+      {
+         if (errno == EINTR)
+            continue;
+         return errno;
+      }
+      else if (bytes_read == 0)
+         return EIO;
+
+      buffer += bytes_read;
+      offset += bytes_read;
+      len -= (size_t)bytes_read;
+   }
+
+   return 0;
+}
+
+/**
+ * Deliver the lines of a file to *user* in reverse order, last
+ * line first, reading blocks back from the end of the file with
+ * *pread*.  The lines are the same as from *read_handle_lines*,
+ * so a terminator at the end of the file doesn't add an empty
+ * line.  Stopping early, for example after the last *n* lines,
+ * reads only the end of the file.
+ *
+ * Each block is read in front of the incomplete line left from
+ * the previous block, so a line longer than RFL_bufflen stops
+ * reading and returns EOVERFLOW.  Handles that cannot *pread*,
+ * like pipes, return ESPIPE.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int read_handle_lines_reverse(int fh, line_user_f user, void *closure)
+{
+   struct stat st;
+
+   if (fstat(fh, &st))
+      return errno;
+
+   if (!S_ISREG(st.st_mode))
+      return ESPIPE;
+
+   char buffer[RFL_bufflen];
+   char *buffend = buffer + sizeof(buffer);
+
+   off_t pos = st.st_size;      // file offset of *data*
+   char *data = buffend;        // beginning of the data in the buffer
+   char *end_line = buffend;    // end of the line whose start is not yet found
+   int check_cr = 0;            // set if *end_line* is at a '\n' that begins a block
+   int at_eof = 1;              // set until a terminator is found
+   int errnum;
+
+   const char *ptr;
+
+   for (;;)
+   {
+      while ((ptr = rfl_find_eol_reverse(data, end_line)))
+      {
+         // A terminator at the end of the file ends the last line
+         if (!at_eof || ptr + 1 < end_line)
+         {
+            if (!(*user)(ptr + 1, end_line, closure))
+               return 0;
+         }
+         at_eof = 0;
+
+         // A '\n' may be the second half of a "\r\n" pair
+         if (*ptr == '\n' && ptr == data && pos > 0)
+         {
+            end_line = data;
+            check_cr = 1;
+            break;
+         }
+         else if (*ptr == '\n' && ptr > data && ptr[-1] == '\r')
+            end_line = (char*)ptr - 1;
+         else
+            end_line = (char*)ptr;
+      }
+
+      if (pos == 0)
+         break;
+
+      // Move the incomplete line to the end of the buffer
+      size_t keep = end_line - data;
+      if (keep == sizeof(buffer))
+         return EOVERFLOW;
+
+      if (end_line < buffend)
+      {
+         memmove(buffend - keep, data, keep);
+         data = buffend - keep;
+         end_line = buffend;
+      }
+
+      // Read the block that precedes *data* in the file
+      size_t len = data - buffer;
+      if ((off_t)len > pos)
+         len = (size_t)pos;
+
+      pos -= len;
+      data -= len;
+      if ((errnum = rfl_pread_all(fh, data, len, pos)))
+         return errnum;
+
+      if (check_cr)
+      {
+         if (end_line[-1] == '\r')
+            --end_line;
+         check_cr = 0;
+      }
+   }
+
+   // The first line of the file
+   if (st.st_size > 0)
+      (*user)(data, end_line, closure);
+
+   return 0;
+}
+
+int read_file_lines_reverse(const char *filepath, line_user_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = read_handle_lines_reverse(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/**
+ * Like *rfl_scan_lines*, but collects the lines in *batch*, passing
+ * the spans to *user* whenever *batch* is full.  Spans left in
+ * *batch* must be delivered before the block is overwritten.
+ *
+ * With SIMD, every terminator in the mask of a block of bytes
+ * is used before the next block is loaded, rather than reloading
+ * from the start of each line, which matters for short lines.
+ */
+static const char *rfl_scan_spans(const char *start_line,
+                                  const char *scan_from,
+                                  const char *end,
+                                  int *skip_lf,
+                                  RFL_SPAN *batch,
+                                  int *count,
+                                  line_spans_f user,
+                                  void *closure)
+{
+   const char *ptr = scan_from;
+   RFL_SPAN *span = batch + *count;
+   RFL_SPAN *batch_end = batch + RFL_SPAN_BATCH;
+
+   if (*skip_lf && ptr < end)
+   {
+      if (*ptr == '\n')
+         start_line = ++ptr;
+      *skip_lf = 0;
+   }
+
+#ifdef RFL_SIMD_WIDTH
+   for (; end - ptr >= RFL_SIMD_WIDTH; ptr += RFL_SIMD_WIDTH)
+   {
+      unsigned mask = rfl_eol_mask(ptr);
+      while (mask)
+      {
+         const char *eol = ptr + __builtin_ctz(mask);
+         mask &= mask - 1;
+
+         // Skip the '\n' of a "\r\n" already consumed
+         if (eol < start_line)
+            continue;
+
+         span->start = start_line;
+         span->end = eol;
+
+         if (*eol++ == '\r')
+         {
+            if (eol == end)
+               *skip_lf = 1;
+            else if (*eol == '\n')
+               ++eol;
+         }
+
+         if (++span == batch_end)
+         {
+            if (!(*user)(batch, RFL_SPAN_BATCH, closure))
+               return NULL;
+            span = batch;
+         }
+
+         start_line = eol;
+      }
+   }
+
+   // A "\r\n" may straddle the last block
+   if (ptr < start_line)
+      ptr = start_line;
+#endif
+
+   while ((ptr = rfl_find_eol(ptr, end)) < end)
+   {
+      span->start = start_line;
+      span->end = ptr;
+
+      if (*ptr++ == '\r')
+      {
+         if (ptr == end)
+            *skip_lf = 1;
+         else if (*ptr == '\n')
+            ++ptr;
+      }
+
+      if (++span == batch_end)
+      {
+         if (!(*user)(batch, RFL_SPAN_BATCH, closure))
+            return NULL;
+         span = batch;
+      }
+
+      start_line = ptr;
+   }
+
+   *count = span - batch;
+
+   return start_line;
+}
+
+/**
+ * Like *read_handle_lines*, but instead of calling a function
+ * for each line, collects the lines of each buffer and passes
+ * them to *user* in arrays of up to RFL_SPAN_BATCH spans.  The
+ * spans are only valid until *user* returns.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int read_handle_line_spans(int fh, line_spans_f user, void *closure)
+{
+   char buffer[RFL_bufflen];
+   char *buffend = buffer + sizeof(buffer);
+
+   RFL_SPAN batch[RFL_SPAN_BATCH];
+   int count = 0;
+
+   char *start_read = buffer;   // memory position at which next read begins
+   char *end_read;              // points to memory position limit of most recent read
+
+   const char *start_line;      // beginning of the incomplete line after a read
+   int skip_lf = 0;             // set if the last read ended with '\r'
+
+   ssize_t bytes_read = 0;      // 0 until a read() fails or reaches EOF
+
+   while (start_read < buffend
+          && 0 < (bytes_read = read(fh, start_read, buffend-start_read)))
+   {
+      end_read = start_read + bytes_read;
+
+      start_line = rfl_scan_spans(buffer, start_read, end_read, &skip_lf,
+                                  batch, &count, user, closure);
+      if (!start_line)
+         return 0;
+
+      // Deliver the spans before moving the incomplete line
+      if (count)
+      {
+         if (!(*user)(batch, count, closure))
+            return 0;
+         count = 0;
+      }
+
+      size_t move_bytes = end_read - start_line;
+
+      if (move_bytes && start_line > buffer)
+         memmove(buffer, start_line, move_bytes);
+
+      start_read = buffer + move_bytes;
+   }
+
+   if (start_read == buffend)
+      return EOVERFLOW;
+
+   if (bytes_read == -1)
+      return errno;
+
+   if (start_read > buffer)
+   {
+      batch[0].start = buffer;
+      batch[0].end = start_read;
+      (*user)(batch, 1, closure);
+   }
+
+   return 0;
+}
+
+int read_file_line_spans(const char *filepath, line_spans_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = read_handle_line_spans(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/**
+ * Like *read_handle_lines*, but maps the entire file into memory
+ * and passes pointers into the mapping to *user*, so no bytes are
+ * copied and line lengths are not limited by RFL_bufflen.  Because
+ * the lines are not in a private buffer, *user* must not write
+ * to them.
+ *
+ * Pipes, terminals, and other handles that cannot be mapped, as
+ * well as empty files, are read with *read_handle_lines*.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int map_handle_lines(int fh, line_user_f user, void *closure)
+{
+   struct stat st;
+
+   if (fstat(fh, &st))
+      return errno;
+
+   if (!S_ISREG(st.st_mode) || st.st_size == 0 || (uintmax_t)st.st_size > SIZE_MAX)
+      return read_handle_lines(fh, user, closure);
+
+   size_t map_len = (size_t)st.st_size;
+   const char *map = (const char*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fh, 0);
+   if (map == (const char*)MAP_FAILED)
+      return read_handle_lines(fh, user, closure);
+
+   // Only a hint, so ignore failure
+   madvise((void*)map, map_len, MADV_SEQUENTIAL);
+
+   const char *end = map + map_len;
+   int skip_lf = 0;
+
+   const char *start_line = rfl_scan_lines(map, map, end, &skip_lf, user, closure);
+   if (start_line && start_line < end)
+      (*user)(start_line, end, closure);
+
+   munmap((void*)map, map_len);
+
+   return 0;
+}
+
+int map_file_lines(const char *filepath, line_user_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = map_handle_lines(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/**
+ * Returns the beginning of the first line that starts at or
+ * after *ptr*, skipping the rest of a line (or of a "\r\n"
+ * pair) that began before *ptr*.
+ */
+static const char *rfl_next_line_start(const char *begin, const char *ptr, const char *end)
+{
+   if (ptr == begin)
+      return ptr;
+
+   // Find the terminator of the line containing ptr[-1]
+   ptr = rfl_find_eol(ptr-1, end);
+
+   if (ptr < end && *ptr++ == '\r' && ptr < end && *ptr == '\n')
+      ++ptr;
+
+   return ptr;
+}
+
+typedef struct rfl_chunk_s {
+   const char  *start;
+   const char  *end;
+   line_user_f user;
+   void        *closure;
+} RFL_CHUNK;
+
+/**
+ * Deliver the lines of one chunk, including a final
+ * unterminated line.  Runs as a thread function.
+ */
+static void *rfl_chunk_lines(void *data)
+{
+   RFL_CHUNK *chunk = (RFL_CHUNK*)data;
+   int skip_lf = 0;
+
+   const char *start_line = rfl_scan_lines(chunk->start, chunk->start, chunk->end,
+                                           &skip_lf, chunk->user, chunk->closure);
+   if (start_line && start_line < chunk->end)
+      (*chunk->user)(start_line, chunk->end, chunk->closure);
+
+   return NULL;
+}
+
+/**
+ * Map the file open on *fh* and divide it into *chunks* ranges of
+ * nearly equal size, each adjusted to begin at the start of a line.
+ * The chunks are processed concurrently, one thread per chunk,
+ * with chunk *i* calling *user* with closure *chunk_closures[i]*.
+ * A callback returning 0 stops only its own chunk.
+ *
+ * After every chunk is finished, *merge*, if not NULL, is called
+ * once for each chunk, in file order, with the chunk index, its
+ * closure, and *closure*, to combine the results.
+ *
+ * Files that cannot be mapped are processed as one chunk in the
+ * calling thread, so *merge* is called only for chunk 0.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int map_handle_lines_parallel(int fh,
+                              int chunks,
+                              line_user_f user,
+                              void **chunk_closures,
+                              chunk_merge_f merge,
+                              void *closure)
+{
+   struct stat st;
+   int errnum = 0;
+   int count = 1;
+
+   if (chunks < 1)
+      return EINVAL;
+
+   if (fstat(fh, &st))
+      return errno;
+
+   const char *map = (const char*)MAP_FAILED;
+   size_t map_len = 0;
+
+   if (S_ISREG(st.st_mode) && st.st_size > 0 && (uintmax_t)st.st_size <= SIZE_MAX)
+   {
+      map_len = (size_t)st.st_size;
+      map = (const char*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, fh, 0);
+   }
+
+   if (map == (const char*)MAP_FAILED)
+      errnum = read_handle_lines(fh, user, chunk_closures[0]);
+   else
+   {
+      madvise((void*)map, map_len, MADV_SEQUENTIAL);
+
+      const char *end = map + map_len;
+
+      RFL_CHUNK cinfo[chunks];
+      pthread_t threads[chunks];
+      int started[chunks];
+
+      count = chunks;
+
+      const char *chunk_start = map;
+      for (int i = 0; i < count; ++i)
+      {
+         const char *chunk_end = end;
+         if (i + 1 < count)
+            chunk_end = rfl_next_line_start(map, map + map_len / count * (i+1), end);
+
+         cinfo[i].start = chunk_start;
+         cinfo[i].end = chunk_end;
+         cinfo[i].user = user;
+         cinfo[i].closure = chunk_closures[i];
+
+         chunk_start = chunk_end;
+      }
+
+      // Chunk 0 runs in this thread, as does any chunk
+      // for which a thread can't be started.
+      for (int i = 1; i < count; ++i)
+      {
+         started[i] = !pthread_create(&threads[i], NULL, rfl_chunk_lines, &cinfo[i]);
+         if (!started[i])
+            rfl_chunk_lines(&cinfo[i]);
+      }
+
+      rfl_chunk_lines(&cinfo[0]);
+
+      for (int i = 1; i < count; ++i)
+         if (started[i])
+            pthread_join(threads[i], NULL);
+
+      munmap((void*)map, map_len);
+   }
+
+   if (merge && !errnum)
+      for (int i = 0; i < count; ++i)
+         (*merge)(i, chunk_closures[i], closure);
+
+   return errnum;
+}
+
+int map_file_lines_parallel(const char *filepath,
+                            int chunks,
+                            line_user_f user,
+                            void **chunk_closures,
+                            chunk_merge_f merge,
+                            void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = map_handle_lines_parallel(fh, chunks, user, chunk_closures, merge, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/*
+ * Asynchronous, multiple-buffer reading.
+ *
+ * RFL_async_count buffers of RFL_async_bufflen bytes are kept
+ * in flight so the next buffers are being read while the current
+ * buffer is scanned.  Each buffer is preceded by RFL_bufflen bytes
+ * of space into which the incomplete line at the end of the
+ * previous buffer is copied, so a line must fit in RFL_bufflen,
+ * as with *read_handle_lines*.
+ *
+ * On Linux, seekable files are read with io_uring, with a helper
+ * thread as the fallback for other handles, older kernels, or
+ * where io_uring is disabled.
+ */
+
+#define RFL_ASYNC_MAX 8
+
+typedef struct rfl_async_s {
+   int     fh;
+   int     count;
+   size_t  bufflen;
+   char    *data[RFL_ASYNC_MAX];
+   ssize_t result[RFL_ASYNC_MAX];   // bytes read or -errno
+   int     full[RFL_ASYNC_MAX];     // set when result is ready
+
+   // helper thread backend
+   pthread_t       thread;
+   pthread_mutex_t mutex;
+   pthread_cond_t  cond;
+   int             stop;
+
+#ifdef RFL_URING
+   // io_uring backend, active if ring_fd != -1
+   int                 ring_fd;
+   unsigned            *sq_head, *sq_tail, *sq_mask, *sq_array;
+   unsigned            *cq_head, *cq_tail, *cq_mask;
+   struct io_uring_sqe *sqes;
+   struct io_uring_cqe *cqes;
+   void                *sq_ptr, *cq_ptr;
+   size_t              sq_len, cq_len, sqes_len;
+   unsigned            in_flight;
+   off_t               offset;                  // file offset of the next buffer
+   off_t               slot_offset[RFL_ASYNC_MAX];  // file offset of each buffer
+   size_t              filled[RFL_ASYNC_MAX];   // bytes read so far into each buffer
+   int                 at_eof;                  // set when a read returned 0
+   off_t               eof_offset;              // where the file ended
+   struct iovec        iov[RFL_ASYNC_MAX];
+#endif
+} RFL_ASYNC;
+
+unsigned RFL_async_bufflen = 1024 * 1024;
+unsigned RFL_async_count = 3;
+
+#ifdef RFL_URING
+
+static void rfl_uring_close(RFL_ASYNC *as)
+{
+   if (as->sqes)
+      munmap(as->sqes, as->sqes_len);
+   if (as->cq_ptr && as->cq_ptr != as->sq_ptr)
+      munmap(as->cq_ptr, as->cq_len);
+   if (as->sq_ptr)
+      munmap(as->sq_ptr, as->sq_len);
+   close(as->ring_fd);
+   as->ring_fd = -1;
+}
+
+/**
+ * Set up an io_uring instance with the raw system calls, so
+ * liburing isn't needed.  Returns 0 for success.
+ */
+static int rfl_uring_open(RFL_ASYNC *as, off_t offset)
+{
+   struct io_uring_params params;
+   memset(&params, 0, sizeof(params));
+
+   as->sq_ptr = as->cq_ptr = as->sqes = NULL;
+
+   as->ring_fd = (int)syscall(__NR_io_uring_setup, (unsigned)as->count, &params);
+   if (as->ring_fd == -1)
+      return -1;
+
+   as->sq_len = params.sq_off.array + params.sq_entries * sizeof(unsigned);
+   as->cq_len = params.cq_off.cqes + params.cq_entries * sizeof(struct io_uring_cqe);
+   as->sqes_len = params.sq_entries * sizeof(struct io_uring_sqe);
+
+   int single = (params.features & IORING_FEAT_SINGLE_MMAP) != 0;
+   if (single && as->cq_len > as->sq_len)
+      as->sq_len = as->cq_len;
+
+   void *ptr = mmap(NULL, as->sq_len, PROT_READ|PROT_WRITE,
+                    MAP_SHARED|MAP_POPULATE, as->ring_fd, IORING_OFF_SQ_RING);
+   if (ptr == MAP_FAILED)
+      goto abandon_ring;
+   as->sq_ptr = ptr;
+
+   if (single)
+      as->cq_ptr = as->sq_ptr;
+   else
+   {
+      ptr = mmap(NULL, as->cq_len, PROT_READ|PROT_WRITE,
+                 MAP_SHARED|MAP_POPULATE, as->ring_fd, IORING_OFF_CQ_RING);
+      if (ptr == MAP_FAILED)
+         goto abandon_ring;
+      as->cq_ptr = ptr;
+   }
+
+   ptr = mmap(NULL, as->sqes_len, PROT_READ|PROT_WRITE,
+              MAP_SHARED|MAP_POPULATE, as->ring_fd, IORING_OFF_SQES);
+   if (ptr == MAP_FAILED)
+      goto abandon_ring;
+   as->sqes = (struct io_uring_sqe*)ptr;
+
+   char *sq = (char*)as->sq_ptr;
+   as->sq_head  = (unsigned*)(sq + params.sq_off.head);
+   as->sq_tail  = (unsigned*)(sq + params.sq_off.tail);
+   as->sq_mask  = (unsigned*)(sq + params.sq_off.ring_mask);
+   as->sq_array = (unsigned*)(sq + params.sq_off.array);
+
+   char *cq = (char*)as->cq_ptr;
+   as->cq_head = (unsigned*)(cq + params.cq_off.head);
+   as->cq_tail = (unsigned*)(cq + params.cq_off.tail);
+   as->cq_mask = (unsigned*)(cq + params.cq_off.ring_mask);
+   as->cqes    = (struct io_uring_cqe*)(cq + params.cq_off.cqes);
+
+   as->in_flight = 0;
+   as->offset = offset;
+   as->at_eof = 0;
+
+   return 0;
+
+  abandon_ring:
+   rfl_uring_close(as);
+   return -1;
+}
+
+/**
+ * Queue a read of the unfilled part of the buffer in *slot*, at
+ * the matching position in the file.  If the kernel doesn't take
+ * the entry, it is withdrawn from the ring, so no completion can
+ * arrive for it later.  Returns 0 for success, or -errno.
+ */
+static int rfl_uring_queue(RFL_ASYNC *as, int slot)
+{
+   unsigned tail = *as->sq_tail;
+   unsigned index = tail & *as->sq_mask;
+
+   as->iov[slot].iov_base = as->data[slot] + as->filled[slot];
+   as->iov[slot].iov_len = as->bufflen - as->filled[slot];
+
+   struct io_uring_sqe *sqe = &as->sqes[index];
+   memset(sqe, 0, sizeof(*sqe));
+   sqe->opcode = IORING_OP_READV;
+   sqe->fd = as->fh;
+   sqe->addr = (uintptr_t)&as->iov[slot];
+   sqe->len = 1;
+   sqe->off = as->slot_offset[slot] + as->filled[slot];
+   sqe->user_data = (unsigned)slot;
+
+   as->sq_array[index] = index;
+   __atomic_store_n(as->sq_tail, tail + 1, __ATOMIC_RELEASE);
+
+   long submitted;
+   while ((submitted = syscall(__NR_io_uring_enter, as->ring_fd, 1, 0, 0, NULL, 0)) == -1
+          && errno == EINTR)
+      ;
+
+   // The kernel has the entry if it moved the head past it
+   if (submitted == 1 || __atomic_load_n(as->sq_head, __ATOMIC_ACQUIRE) != tail)
+   {
+      ++as->in_flight;
+      return 0;
+   }
+
+   int errnum = submitted == -1 ? errno : EAGAIN;
+   __atomic_store_n(as->sq_tail, tail, __ATOMIC_RELEASE);
+   return -errnum;
+}
+
+/**
+ * Consume one completion, waiting for it if necessary.
+ *
+ * A short read is continued where it stopped, so a buffer is
+ * only ready when it's full, at end-of-file, or after an error,
+ * and consecutive buffers hold consecutive parts of the file.
+ */
+static void rfl_uring_reap(RFL_ASYNC *as)
+{
+   unsigned head = *as->cq_head;
+
+   while (head == __atomic_load_n(as->cq_tail, __ATOMIC_ACQUIRE))
+      syscall(__NR_io_uring_enter, as->ring_fd, 0, 1, IORING_ENTER_GETEVENTS, NULL, 0);
+
+   struct io_uring_cqe *cqe = &as->cqes[head & *as->cq_mask];
+   int slot = (int)cqe->user_data;
+   int res = cqe->res;
+   --as->in_flight;
+
+   __atomic_store_n(as->cq_head, head + 1, __ATOMIC_RELEASE);
+
+   if (res < 0)
+      as->result[slot] = res;
+   else if (res > 0 && (as->filled[slot] += (size_t)res) < as->bufflen)
+   {
+      int errnum = rfl_uring_queue(as, slot);
+      if (!errnum)
+         return;
+      as->result[slot] = errnum;
+   }
+   else
+   {
+      as->result[slot] = (ssize_t)as->filled[slot];
+
+      // Note where the file ended, to ignore later buffers
+      if (res == 0)
+      {
+         off_t end = as->slot_offset[slot] + (off_t)as->filled[slot];
+         if (!as->at_eof || end < as->eof_offset)
+            as->eof_offset = end;
+         as->at_eof = 1;
+      }
+   }
+
+   as->full[slot] = 1;
+}
+
+/**
+ * Start filling the buffer in *slot* with the next part of the file.
+ */
+static void rfl_uring_submit(RFL_ASYNC *as, int slot)
+{
+   as->slot_offset[slot] = as->offset;
+   as->filled[slot] = 0;
+   as->offset += as->bufflen;
+
+   if (as->at_eof)
+   {
+      as->result[slot] = 0;
+      as->full[slot] = 1;
+      return;
+   }
+
+   as->full[slot] = 0;
+
+   // Report the failure as the read result
+   int errnum = rfl_uring_queue(as, slot);
+   if (errnum)
+   {
+      as->result[slot] = errnum;
+      as->full[slot] = 1;
+   }
+}
+
+#endif  // RFL_URING
+
+/**
+ * Helper thread that fills the buffers in order.  It can be
+ * cancelled only while blocked in read(), not while it holds
+ * the mutex.
+ */
+static void *rfl_async_reader(void *data)
+{
+   RFL_ASYNC *as = (RFL_ASYNC*)data;
+   int slot = 0;
+   int stop;
+
+   pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+   for (;;)
+   {
+      pthread_mutex_lock(&as->mutex);
+      while (as->full[slot] && !as->stop)
+         pthread_cond_wait(&as->cond, &as->mutex);
+      stop = as->stop;
+      pthread_mutex_unlock(&as->mutex);
+
+      if (stop)
+         break;
+
+      ssize_t bytes_read;
+      pthread_setcancelstate(PTHREAD_CANCEL_ENABLE, NULL);
+      while ((bytes_read = read(as->fh, as->data[slot], as->bufflen)) == -1 && errno == EINTR)
+         ;
+      pthread_setcancelstate(PTHREAD_CANCEL_DISABLE, NULL);
+
+      pthread_mutex_lock(&as->mutex);
+      as->result[slot] = bytes_read == -1 ? -errno : bytes_read;
+      as->full[slot] = 1;
+      pthread_cond_broadcast(&as->cond);
+      pthread_mutex_unlock(&as->mutex);
+
+      if (bytes_read <= 0)
+         break;
+
+      slot = (slot + 1) % as->count;
+   }
+
+   return NULL;
+}
+
+/**
+ * Start reading into every buffer.  Returns 0 for success,
+ * or an errno value if neither backend can be started.
+ */
+static int rfl_async_start(RFL_ASYNC *as)
+{
+   for (int i = 0; i < as->count; ++i)
+      as->full[i] = 0;
+
+#ifdef RFL_URING
+   struct stat st;
+   off_t offset;
+   if (!fstat(as->fh, &st) && S_ISREG(st.st_mode)
+       && (offset = lseek(as->fh, 0, SEEK_CUR)) != -1
+       && !rfl_uring_open(as, offset))
+   {
+      for (int i = 0; i < as->count; ++i)
+         rfl_uring_submit(as, i);
+      return 0;
+   }
+#endif
+
+   as->stop = 0;
+   pthread_mutex_init(&as->mutex, NULL);
+   pthread_cond_init(&as->cond, NULL);
+
+   int errnum = pthread_create(&as->thread, NULL, rfl_async_reader, as);
+   if (errnum)
+   {
+      pthread_cond_destroy(&as->cond);
+      pthread_mutex_destroy(&as->mutex);
+   }
+
+   return errnum;
+}
+
+/**
+ * Wait for the buffer in *slot* to be filled.
+ * Returns the number of bytes read, 0 at end-of-file, or -errno.
+ */
+static ssize_t rfl_async_wait(RFL_ASYNC *as, int slot)
+{
+#ifdef RFL_URING
+   if (as->ring_fd != -1)
+   {
+      while (!as->full[slot])
+         rfl_uring_reap(as);
+
+      // A buffer past the end of the file was read after the file
+      // grew, and would leave a gap, so end with the earlier buffer
+      if (as->at_eof && as->slot_offset[slot] >= as->eof_offset)
+         return 0;
+
+      return as->result[slot];
+   }
+#endif
+
+   pthread_mutex_lock(&as->mutex);
+   while (!as->full[slot])
+      pthread_cond_wait(&as->cond, &as->mutex);
+   ssize_t result = as->result[slot];
+   pthread_mutex_unlock(&as->mutex);
+
+   return result;
+}
+
+/**
+ * Return a scanned buffer to be filled again.
+ */
+static void rfl_async_submit(RFL_ASYNC *as, int slot)
+{
+#ifdef RFL_URING
+   if (as->ring_fd != -1)
+   {
+      rfl_uring_submit(as, slot);
+      return;
+   }
+#endif
+
+   pthread_mutex_lock(&as->mutex);
+   as->full[slot] = 0;
+   pthread_cond_broadcast(&as->cond);
+   pthread_mutex_unlock(&as->mutex);
+}
+
+/**
+ * Stop reading, waiting for outstanding reads so the
+ * buffers can be safely released.
+ */
+static void rfl_async_stop(RFL_ASYNC *as)
+{
+#ifdef RFL_URING
+   if (as->ring_fd != -1)
+   {
+      while (as->in_flight)
+         rfl_uring_reap(as);
+      rfl_uring_close(as);
+      return;
+   }
+#endif
+
+   pthread_mutex_lock(&as->mutex);
+   as->stop = 1;
+   pthread_cond_broadcast(&as->cond);
+   pthread_mutex_unlock(&as->mutex);
+
+   // Interrupt a read() that may block indefinitely on a pipe
+   pthread_cancel(as->thread);
+   pthread_join(as->thread, NULL);
+
+   pthread_cond_destroy(&as->cond);
+   pthread_mutex_destroy(&as->mutex);
+}
+
+/**
+ * Like *read_handle_lines*, but reads ahead into RFL_async_count
+ * buffers (2 to 8) so reading overlaps scanning.  Because the file
+ * is read ahead, the position of *fh* is unspecified afterwards.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int read_handle_lines_async(int fh, line_user_f user, void *closure)
+{
+   RFL_ASYNC as;
+   memset(&as, 0, sizeof(as));
+
+   int count = RFL_async_count;
+   if (count < 2)
+      count = 2;
+   else if (count > RFL_ASYNC_MAX)
+      count = RFL_ASYNC_MAX;
+
+   size_t prefix = RFL_bufflen;
+   size_t slot_len = prefix + RFL_async_bufflen;
+
+   char *block = (char*)malloc(slot_len * count);
+   if (!block)
+      return ENOMEM;
+
+   as.fh = fh;
+   as.count = count;
+   as.bufflen = RFL_async_bufflen;
+   for (int i = 0; i < count; ++i)
+      as.data[i] = block + slot_len * i + prefix;
+#ifdef RFL_URING
+   as.ring_fd = -1;
+#endif
+
+   int errnum = rfl_async_start(&as);
+   if (errnum)
+      goto abandon_block;
+
+   const char *carry = NULL;    // incomplete line at the end of the previous buffer
+   size_t carry_len = 0;
+   int carry_slot = -1;         // buffer holding *carry*, not yet resubmitted
+   int skip_lf = 0;             // set if the last buffer ended with '\r'
+
+   for (int slot = 0; ; slot = (slot + 1) % count)
+   {
+      ssize_t bytes_read = rfl_async_wait(&as, slot);
+      if (bytes_read <= 0)
+      {
+         if (bytes_read < 0)
+            errnum = (int)-bytes_read;
+         else if (carry_len)
+            (*user)(carry, carry + carry_len, closure);
+         break;
+      }
+
+      // Join the incomplete line to the new data
+      char *data = as.data[slot];
+      char *start = data - carry_len;
+      if (carry_len)
+         memcpy(start, carry, carry_len);
+
+      if (carry_slot != -1)
+         rfl_async_submit(&as, carry_slot);
+
+      const char *end = data + bytes_read;
+      const char *start_line = rfl_scan_lines(start, data, end, &skip_lf, user, closure);
+      if (!start_line)
+         break;
+
+      carry = start_line;
+      carry_len = end - start_line;
+      carry_slot = slot;
+
+      if (carry_len > prefix)
+      {
+         errnum = EOVERFLOW;
+         break;
+      }
+   }
+
+   rfl_async_stop(&as);
+
+  abandon_block:
+   free(block);
+   return errnum;
+}
+
+int read_file_lines_async(const char *filepath, line_user_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = read_handle_lines_async(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/*
+ * Transparent decompression.
+ *
+ * Define RFL_GZIP (and link with -lz) to read gzip files, and
+ * RFL_ZSTD (and link with -lzstd) to read zstd files.  Each
+ * block of decompressed bytes is scanned as it is produced,
+ * so the uncompressed file is never stored in memory.
+ */
+
+#define RFL_INBUFF_LEN (64 * 1024)
+
+#if defined(RFL_GZIP) || defined(RFL_ZSTD)
+/**
+ * Refill *in* from the file if it has been used up.
+ * Returns -1 with errno set if read() fails.
+ */
+static int rfl_source_fill(RFL_SOURCE *source)
+{
+   if (source->in_pos == source->in_end && !source->in_eof)
+   {
+      ssize_t bytes_read = read(source->fh, source->in, source->in_size);
+      if (bytes_read == -1)
+         return -1;
+
+      source->in_pos = 0;
+      source->in_end = (size_t)bytes_read;
+      source->in_eof = bytes_read == 0;
+   }
+
+   return 0;
+}
+#endif
+
+#ifdef RFL_GZIP
+
+/**
+ * Inflate gzip members into *buffer*.  Concatenated members, as
+ * made by appending to a .gz file, are read as one stream.
+ */
+static ssize_t rfl_source_gzip(RFL_SOURCE *source, char *buffer, size_t len)
+{
+   z_stream *zs = (z_stream*)source->state;
+
+   zs->next_out = (Bytef*)buffer;
+   zs->avail_out = (uInt)len;
+
+   while (zs->avail_out == len)
+   {
+      if (rfl_source_fill(source))
+         return -1;
+
+      if (source->in_pos == source->in_end)
+      {
+         if (source->ended)
+            break;
+
+         // Truncated file
+         errno = EBADMSG;
+         return -1;
+      }
+
+      zs->next_in = source->in + source->in_pos;
+      zs->avail_in = (uInt)(source->in_end - source->in_pos);
+
+      int ret = inflate(zs, Z_NO_FLUSH);
+
+      source->in_pos = source->in_end - zs->avail_in;
+
+      if (ret == Z_STREAM_END)
+      {
+         source->ended = 1;
+         inflateReset(zs);
+      }
+      else if (ret == Z_OK || ret == Z_BUF_ERROR)
+         source->ended = 0;
+      else
+      {
+         errno = ret == Z_MEM_ERROR ? ENOMEM : EBADMSG;
+         return -1;
+      }
+   }
 
-#include <sys/types.h> // for open()
-#include <sys/stat.h>
-#include <fcntl.h>
+   return (ssize_t)(len - zs->avail_out);
+}
 
-#include <unistd.h>    // for read()
-#include <errno.h>     // for strerror()
+static int rfl_gzip_lines(RFL_SOURCE *source, line_user_f user, void *closure)
+{
+   z_stream zs;
+   memset(&zs, 0, sizeof(zs));
 
-#include "read_file_lines.h"
+   // 15 + 32: largest window, detect gzip or zlib header
+   if (inflateInit2(&zs, 15 + 32) != Z_OK)
+      return ENOMEM;
 
+   source->state = &zs;
+   source->read = rfl_source_gzip;
 
-unsigned RFL_bufflen = 2048;
+   char buffer[RFL_bufflen];
+   int errnum = rfl_read_lines(source, buffer, sizeof(buffer), sizeof(buffer), user, NULL, closure);
+
+   inflateEnd(&zs);
+   return errnum;
+}
+
+#endif  // RFL_GZIP
+
+#ifdef RFL_ZSTD
 
 /**
- * Returns 0 for success, the errno value if it fails.
+ * Decompress zstd frames into *buffer*.  Consecutive
+ * frames are read as one stream.
  */
-int read_handle_lines(int fh, line_user_f user, void *closure)
+static ssize_t rfl_source_zstd(RFL_SOURCE *source, char *buffer, size_t len)
 {
-   char buffer[RFL_bufflen];
-   char *buffend = buffer + sizeof(buffer);
+   ZSTD_DCtx *dctx = (ZSTD_DCtx*)source->state;
+   ZSTD_outBuffer out = { buffer, len, 0 };
 
-   char *start_read = buffer;   // memory position at which next read begins
-   char *end_read;              // points to memory position limit of most recent read
+   while (out.pos == 0)
+   {
+      if (rfl_source_fill(source))
+         return -1;
 
-   char *start_line = NULL;     // beginning of the next-to-be-saved line
-   char *end_line = NULL;       // end of the next-to-be-saved line
-   char *next_line = NULL;      // position to copy to start_line after the line is saved
+      int no_input = source->in_pos == source->in_end;
+      if (no_input && source->ended)
+         break;
 
-   char *ptr;                   // pointer to most-recently considered char
+      ZSTD_inBuffer in = { source->in, source->in_end, source->in_pos };
+      size_t ret = ZSTD_decompressStream(dctx, &out, &in);
+      if (ZSTD_isError(ret))
+      {
+         errno = EBADMSG;
+         return -1;
+      }
 
-   size_t bytes_read;
+      source->in_pos = in.pos;
 
-   while (0 < (bytes_read = read(fh, start_read, buffend-start_read)))
-   {
-      // clear left-over values from last processed line
-      end_line = next_line = NULL;
+      // 0 means a frame is complete and flushed
+      source->ended = ret == 0;
 
-      if (bytes_read == -1)
-         return errno;
-      else if (bytes_read == 0)
+      // Truncated file
+      if (no_input && out.pos == 0)
       {
-         end_line = start_read;
-         break;
+         errno = EBADMSG;
+         return -1;
       }
+   }
 
-      // All loops should start at the beginning of a line
-      start_line = ptr = buffer;
+   return (ssize_t)out.pos;
+}
 
-      // Keep track of the end of the data
-      end_read = start_read + bytes_read;
+typedef struct rfl_zframe_s {
+   const char *src;
+   size_t     src_len;
+   char       *dst;
+   size_t     dst_len;
+   int        failed;
+} RFL_ZFRAME;
+
+/**
+ * Decompress one frame.  Runs as a thread function.
+ */
+static void *rfl_zstd_frame(void *data)
+{
+   RFL_ZFRAME *frame = (RFL_ZFRAME*)data;
+   size_t ret = ZSTD_decompress(frame->dst, frame->dst_len, frame->src, frame->src_len);
+   frame->failed = ZSTD_isError(ret) || ret != frame->dst_len;
+   return NULL;
+}
+
+/**
+ * Decompress the frames of a mapped zstd file in parallel, one
+ * thread per frame, as many frames at a time as there are processors.
+ * Each frame is decompressed to its own buffer, preceded by
+ * RFL_bufflen bytes for the incomplete line from the previous frame,
+ * and the buffers are scanned in order.
+ *
+ * Returns -1 if the file can't be decompressed this way because
+ * it has only one frame or a frame with an unrecorded size, or
+ * 0 or an errno value if it was processed.
+ */
+static int rfl_zstd_parallel(const char *data, size_t len, line_user_f user, void *closure)
+{
+   const char *end = data + len;
+   size_t frame_count = 0;
 
-      while (ptr < end_read)
+   // Collect frame information
+   for (const char *ptr = data; ptr < end; ++frame_count)
+   {
+      size_t frame_len = ZSTD_findFrameCompressedSize(ptr, end - ptr);
+      unsigned long long content_len = ZSTD_getFrameContentSize(ptr, end - ptr);
+      if (ZSTD_isError(frame_len)
+          || content_len == ZSTD_CONTENTSIZE_UNKNOWN
+          || content_len == ZSTD_CONTENTSIZE_ERROR
+          || content_len > SIZE_MAX - RFL_bufflen)
+         return -1;
+      ptr += frame_len;
+   }
+
+   if (frame_count < 2)
+      return -1;
+
+   long cpus = sysconf(_SC_NPROCESSORS_ONLN);
+   int wave = cpus < 2 ? 2 : cpus > RFL_ASYNC_MAX ? RFL_ASYNC_MAX : (int)cpus;
+
+   RFL_ZFRAME frames[wave];
+   pthread_t threads[wave];
+   int started[wave];
+
+   char *carry_buff = NULL;     // buffer holding the incomplete line
+   const char *carry = NULL;
+   size_t carry_len = 0;
+   int skip_lf = 0;
+   int errnum = 0;
+   int stopped = 0;
+
+   size_t prefix = RFL_bufflen;
+   const char *ptr = data;
+
+   while (ptr < end && !errnum && !stopped)
+   {
+      int count = 0;
+      for (; count < wave && ptr < end; ++count)
       {
-         if (*ptr == '\r')
-         {
-            end_line = ptr;
-            ++ptr;
+         RFL_ZFRAME *frame = &frames[count];
+         frame->src = ptr;
+         frame->src_len = ZSTD_findFrameCompressedSize(ptr, end - ptr);
+         frame->dst_len = (size_t)ZSTD_getFrameContentSize(ptr, end - ptr);
+         frame->dst = (char*)malloc(prefix + frame->dst_len + 1);
+         frame->failed = 0;
+         ptr += frame->src_len;
 
-            if (*ptr == '\n')
-               next_line = ++ptr;
-            else
-               next_line = ptr;
-         }
-         else if (*ptr == '\n')
+         if (!frame->dst)
          {
-            end_line = ptr;
-            next_line = ++ptr;
+            errnum = ENOMEM;
+            break;
          }
-         else
-            ++ptr;
+         frame->dst += prefix;
+      }
+
+      for (int i = 0; i < count; ++i)
+         if (!(started[i] = !pthread_create(&threads[i], NULL, rfl_zstd_frame, &frames[i])))
+            rfl_zstd_frame(&frames[i]);
+
+      for (int i = 0; i < count; ++i)
+         if (started[i])
+            pthread_join(threads[i], NULL);
 
-         if (end_line)
+      for (int i = 0; i < count; ++i)
+      {
+         RFL_ZFRAME *frame = &frames[i];
+
+         if (!errnum && !stopped)
          {
-            if (!(*user)(start_line, end_line, closure))
-               goto abandon_function;
+            if (frame->failed)
+               errnum = EBADMSG;
             else
             {
-               end_line = NULL;
-               if (next_line >= buffer && next_line < end_read)
-                  start_line = next_line;
+               char *start = frame->dst - carry_len;
+               if (carry_len)
+                  memcpy(start, carry, carry_len);
+
+               const char *frame_end = frame->dst + frame->dst_len;
+               const char *start_line = rfl_scan_lines(start, frame->dst, frame_end,
+                                                       &skip_lf, user, closure);
+               if (!start_line)
+                  stopped = 1;
+               else if ((carry_len = frame_end - start_line) > prefix)
+                  errnum = EOVERFLOW;
                else
                {
-                  start_line = end_read;
-                  break;
+                  // Keep the incomplete line with its buffer
+                  free(carry_buff);
+                  carry_buff = frame->dst - prefix;
+                  carry = start_line;
+                  frame->dst = NULL;
                }
             }
          }
+
+         if (frame->dst)
+            free(frame->dst - prefix);
       }
+   }
 
-      // Prepare pointers for loop to next read():
+   if (!errnum && !stopped && carry_len)
+      (*user)(carry, carry + carry_len, closure);
 
-      // measure length of the incomplete line
-      int move_bytes = end_read - start_line;
+   free(carry_buff);
+   return errnum;
+}
+
+static int rfl_zstd_lines(RFL_SOURCE *source, line_user_f user, void *closure)
+{
+   struct stat st;
+   off_t offset;
 
-      if (move_bytes)
+   // Try parallel decompression if the file can be mapped
+   if (!fstat(source->fh, &st)
+       && S_ISREG(st.st_mode)
+       && (offset = lseek(source->fh, 0, SEEK_CUR)) != -1
+       && (uintmax_t)st.st_size <= SIZE_MAX)
+   {
+      // Start of the zstd data, before the bytes read to identify it
+      offset -= (off_t)(source->in_end - source->in_pos);
+
+      size_t map_len = (size_t)st.st_size;
+      const char *map = (const char*)mmap(NULL, map_len, PROT_READ, MAP_PRIVATE, source->fh, 0);
+      if (map != (const char*)MAP_FAILED)
       {
-         // copy incomplete line beginning of the buffer
-         memcpy(buffer, start_line, move_bytes);
-         // prepare to read file to byte following incomplete line
-         start_read = end_line = buffer + move_bytes;
+         madvise((void*)map, map_len, MADV_SEQUENTIAL);
+         int errnum = rfl_zstd_parallel(map + offset, map_len - offset, user, closure);
+         munmap((void*)map, map_len);
+         if (errnum != -1)
+            return errnum;
       }
-      else
-         start_read = end_line = buffer;
    }
 
-   if (end_line > buffer)
-      (*user)(buffer, end_line, closure);
+   ZSTD_DCtx *dctx = ZSTD_createDCtx();
+   if (!dctx)
+      return ENOMEM;
+
+   source->state = dctx;
+   source->read = rfl_source_zstd;
+
+   char buffer[RFL_bufflen];
+   int errnum = rfl_read_lines(source, buffer, sizeof(buffer), sizeof(buffer), user, NULL, closure);
+
+   ZSTD_freeDCtx(dctx);
+   return errnum;
+}
+
+#endif  // RFL_ZSTD
+
+/**
+ * Like *read_handle_lines*, but reads gzip or zstd files,
+ * identified by their first bytes, through a decompressor.
+ * Other files are read unchanged.
+ *
+ * Returns 0 for success, the errno value if it fails, including
+ * ENOTSUP for a compression format not enabled when compiled, or
+ * EBADMSG for corrupt or truncated compressed data.
+ */
+int read_handle_lines_decompress(int fh, line_user_f user, void *closure)
+{
+   RFL_SOURCE source;
+   memset(&source, 0, sizeof(source));
+
+   source.fh = fh;
+   source.read = rfl_source_fd;
+   source.in_size = RFL_INBUFF_LEN;
+   source.in = (unsigned char*)malloc(source.in_size);
+   if (!source.in)
+      return ENOMEM;
+
+   int errnum = 0;
+
+   // Read enough to identify the format
+   while (source.in_end < 4)
+   {
+      ssize_t bytes_read = read(fh, source.in + source.in_end, source.in_size - source.in_end);
+      if (bytes_read == -1)
+      {
+         errnum = errno;
+         goto abandon_function;
+      }
+      else if (bytes_read == 0)
+      {
+         source.in_eof = 1;
+         break;
+      }
+
+      source.in_end += bytes_read;
+   }
+
+   const unsigned char *magic = source.in;
+   if (source.in_end >= 2 && magic[0] == 0x1f && magic[1] == 0x8b)
+   {
+#ifdef RFL_GZIP
+      errnum = rfl_gzip_lines(&source, user, closure);
+#else
+      errnum = ENOTSUP;
+#endif
+   }
+   else if (source.in_end >= 4
+            && magic[0] == 0x28 && magic[1] == 0xb5 && magic[2] == 0x2f && magic[3] == 0xfd)
+   {
+#ifdef RFL_ZSTD
+      errnum = rfl_zstd_lines(&source, user, closure);
+#else
+      errnum = ENOTSUP;
+#endif
+   }
+   else
+   {
+      char buffer[RFL_bufflen];
+      errnum = rfl_read_lines(&source, buffer, sizeof(buffer), sizeof(buffer), user, NULL, closure);
+   }
 
   abandon_function:
-   return 0;
+   free(source.in);
+   return errnum;
+}
+
+int read_file_lines_decompress(const char *filepath, line_user_f user, void *closure)
+{
+   int errnum = 0;
+   int fh = open(filepath, O_RDONLY);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      errnum = read_handle_lines_decompress(fh, user, closure);
+      close(fh);
+   }
+
+   return errnum;
+}
+
+/*
+ * Following a growing file.
+ */
+
+#ifdef __linux__
+
+// Milliseconds to wait for more data before returning, -1 to wait forever
+int RFL_follow_timeout = -1;
+
+typedef struct rfl_follow_s {
+   const char *path;
+   int        ifd;          // inotify instance
+   int        wd_file;      // watch on the open file
+   char       last;         // last byte passed to the scanner
+} RFL_FOLLOW;
+
+#define RFL_FILE_EVENTS (IN_MODIFY | IN_ATTRIB | IN_MOVE_SELF | IN_DELETE_SELF)
+
+/**
+ * Discard queued inotify events, which only serve to wake *poll*.
+ */
+static void rfl_follow_drain(RFL_FOLLOW *follow)
+{
+   char events[4096];
+   while (read(follow->ifd, events, sizeof(events)) > 0)
+      ;
+}
+
+/**
+ * Read the file, waiting for more when reaching the end.
+ *
+ * At the end of the file, a file shorter than the read position
+ * has been truncated and is read again from the beginning, and
+ * a different file at *path* means the file was rotated, so the
+ * new file is opened.  In either case, an incomplete line is
+ * ended with a '\n' so it's not joined to the new text.
+ *
+ * Returns 0 only if RFL_follow_timeout passes without a change.
+ */
+static ssize_t rfl_source_follow(RFL_SOURCE *source, char *buffer, size_t len)
+{
+   RFL_FOLLOW *follow = (RFL_FOLLOW*)source->state;
+   struct stat fst, pst;
+
+   for (;;)
+   {
+      ssize_t bytes_read = read(source->fh, buffer, len);
+      if (bytes_read > 0)
+         follow->last = buffer[bytes_read-1];
+      if (bytes_read != 0)
+         return bytes_read;
+
+      if (fstat(source->fh, &fst))
+         return -1;
+
+      int truncated = fst.st_size < lseek(source->fh, 0, SEEK_CUR);
+      int rotated = !truncated
+         && !stat(follow->path, &pst)
+         && (pst.st_ino != fst.st_ino || pst.st_dev != fst.st_dev);
+
+      if (truncated || rotated)
+      {
+         if (rotated)
+         {
+            int fh = open(follow->path, O_RDONLY);
+            if (fh == -1)
+               return -1;
+
+            inotify_rm_watch(follow->ifd, follow->wd_file);
+            follow->wd_file = inotify_add_watch(follow->ifd, follow->path, RFL_FILE_EVENTS);
+
+            close(source->fh);
+            source->fh = fh;
+         }
+         else
+            lseek(source->fh, 0, SEEK_SET);
+
+         if (follow->last != '\n' && follow->last != '\r' && follow->last)
+         {
+            follow->last = *buffer = '\n';
+            return 1;
+         }
+         continue;
+      }
+
+      struct pollfd pfd = { follow->ifd, POLLIN, 0 };
+      int ready = poll(&pfd, 1, RFL_follow_timeout);
+      if (ready == -1 && errno != EINTR)
+         return -1;
+      else if (ready == 0)
+         return 0;
+
+      rfl_follow_drain(follow);
+   }
+}
+
+/**
+ * Deliver the lines of a file, like *read_file_lines*, then wait
+ * for lines to be appended and deliver them as they arrive, like
+ * *tail -F*.  The file is watched with inotify, as is its directory
+ * to notice when a rotated log is replaced, and the same buffer
+ * is used throughout.
+ *
+ * Following stops when *user* returns 0, or when RFL_follow_timeout
+ * milliseconds pass without a change (never, by default), which
+ * delivers an incomplete last line and returns 0.
+ *
+ * Returns 0 for success, the errno value if it fails.
+ */
+int follow_file_lines(const char *filepath, line_user_f user, void *closure)
+{
+   int errnum = 0;
+
+   RFL_FOLLOW follow;
+   memset(&follow, 0, sizeof(follow));
+   follow.path = filepath;
+
+   RFL_SOURCE source;
+   memset(&source, 0, sizeof(source));
+   source.read = rfl_source_follow;
+   source.state = &follow;
+
+   source.fh = open(filepath, O_RDONLY);
+   if (source.fh == -1)
+      return errno;
+
+   follow.ifd = inotify_init1(IN_NONBLOCK | IN_CLOEXEC);
+   if (follow.ifd == -1)
+   {
+      errnum = errno;
+      goto abandon_file;
+   }
+
+   follow.wd_file = inotify_add_watch(follow.ifd, filepath, RFL_FILE_EVENTS);
+
+   // Watch the directory for a replacement file
+   const char *slash = strrchr(filepath, '/');
+   if (slash)
+   {
+      size_t dir_len = slash == filepath ? 1 : (size_t)(slash - filepath);
+      char dir[dir_len + 1];
+      memcpy(dir, filepath, dir_len);
+      dir[dir_len] = '\0';
+      inotify_add_watch(follow.ifd, dir, IN_CREATE | IN_MOVED_TO);
+   }
+   else
+      inotify_add_watch(follow.ifd, ".", IN_CREATE | IN_MOVED_TO);
+
+   if (follow.wd_file == -1)
+      errnum = errno;
+   else
+   {
+      char buffer[RFL_bufflen];
+      errnum = rfl_read_lines(&source, buffer, sizeof(buffer), sizeof(buffer), user, NULL, closure);
+   }
+
+   close(follow.ifd);
+
+  abandon_file:
+   close(source.fh);
+   return errnum;
 }
 
+#endif  // __linux__
+
 int read_file_lines(const char *filepath, line_user_f user, void *closure)
 {
    int errnum = 0;
@@ -133,10 +2074,11 @@ int read_file_lines(const char *filepath, line_user_f user, void *closure)
 // These includes only necessary for this specific implementation:
 #include <stdio.h>
 #include "commaize.c"
+#include "atoi.c"      // for atoi_swar()
 
 #include <ctype.h>     // for isspace()
 #include <stdint.h>    // for uint64_t type
-#include <stdlib.h>    // for atol()
+#include <time.h>      // for clock_gettime()
 
 #include <readargs.h> 
 
@@ -152,14 +2094,11 @@ void interpret_string_number(const char /*in*/ *start, const char /*in*/ *end,
    while (isdigit(*ptr))
       --ptr;
 
-   // copy number in case, on the last iteration,
-   // the character following *end is another numeral
-   int numlen = end - ptr - 1;
-   char numstr[numlen+1];
-   memcpy(numstr, ptr+1, numlen);
-   numstr[numlen] = '\0';
-
-   *number = atol(numstr);
+   // Parsing within [ptr+1, end) needs no copy, even if the
+   // character following *end* is another numeral
+   ITYPE value = 0;
+   atoi_swar(ptr+1, end, 10, &value, NULL);
+   *number = value;
 
    while (isspace(*ptr))
       --ptr;
@@ -184,12 +2123,162 @@ rfl_bool read_file_lines_user(const char *start, const char *end, void *closure)
    return 1;
 }
 
+/**
+ * Overflow callback for test case, reports and skips the line.
+ * The *closure* points to the line length limit.  The span is
+ * not terminated, so at most its first 20 bytes are printed.
+ */
+rfl_bool read_file_lines_overflow(const char *start, const char *end, void *closure)
+{
+   printf("Skipping a line longer than %d bytes, beginning with \"%.*s\".\n",
+          *(int*)closure,
+          (int)(end - start < 20 ? end - start : 20), start);
+   return 1;
+}
+
+/**
+ * Callback function for timing test, counts the lines.
+ */
+rfl_bool read_file_lines_count(const char *start, const char *end, void *closure)
+{
+   ++*(long*)closure;
+   return 1;
+}
+
+/**
+ * Batch callback for timing test, counts the lines of each batch.
+ */
+rfl_bool read_file_lines_count_spans(const RFL_SPAN *spans, int count, void *closure)
+{
+   *(long*)closure += count;
+   return 1;
+}
+
+/**
+ * Batch callback for test case, prints each line of the batch.
+ */
+rfl_bool read_file_lines_user_spans(const RFL_SPAN *spans, int count, void *closure)
+{
+   const RFL_SPAN *end = spans + count;
+   for (; spans < end; ++spans)
+      read_file_lines_user(spans->start, spans->end, closure);
+   return 1;
+}
+
+/**
+ * Callback for reverse test case, prints lines until
+ * the count in *closure* runs out.
+ */
+rfl_bool read_file_lines_tail(const char *start, const char *end, void *closure)
+{
+   read_file_lines_user(start, end, NULL);
+   return --*(int*)closure > 0;
+}
+
+/**
+ * Merge callback for parallel timing test, sums the chunk line counts.
+ */
+void read_file_lines_sum(int chunk, void *chunk_closure, void *closure)
+{
+   *(long*)closure += *(long*)chunk_closure;
+}
+
+/**
+ * Count lines with *map_file_lines_parallel*, using *chunks* threads.
+ */
+int count_lines_parallel(const char *path, int chunks, long *lines)
+{
+   long counts[chunks];
+   void *closures[chunks];
+   for (int i = 0; i < chunks; ++i)
+   {
+      counts[i] = 0;
+      closures[i] = &counts[i];
+   }
+
+   return map_file_lines_parallel(path, chunks,
+                                  read_file_lines_count, closures,
+                                  read_file_lines_sum, lines);
+}
+
+/**
+ * Count the lines of a file, reporting the elapsed time and speed.
+ * Compile with -DRFL_NO_SIMD to compare with the byte-by-byte scan,
+ * or with -mavx2 to scan 32 bytes at a time.  Use -m to compare
+ * *map_file_lines* with *read_file_lines*, or -p to divide the file
+ * among *chunks* threads, -a to read ahead with
+ * *read_file_lines_async*, or -s to receive batches of lines
+ * from *read_file_line_spans*.
+ */
+int time_line_scan(const char *path, int use_map, int chunks, int use_async, int use_spans)
+{
+   struct stat st;
+   if (stat(path, &st))
+      return errno;
+
+   long lines = 0;
+   struct timespec ts_start, ts_end;
+
+   clock_gettime(CLOCK_MONOTONIC, &ts_start);
+   int errnum;
+   if (chunks > 0)
+      errnum = count_lines_parallel(path, chunks, &lines);
+   else if (use_map)
+      errnum = map_file_lines(path, read_file_lines_count, &lines);
+   else if (use_async)
+      errnum = read_file_lines_async(path, read_file_lines_count, &lines);
+   else if (use_spans)
+      errnum = read_file_line_spans(path, read_file_lines_count_spans, &lines);
+   else
+      errnum = read_file_lines(path, read_file_lines_count, &lines);
+   clock_gettime(CLOCK_MONOTONIC, &ts_end);
+
+   if (!errnum)
+   {
+      double secs = (ts_end.tv_sec - ts_start.tv_sec)
+         + (ts_end.tv_nsec - ts_start.tv_nsec) / 1e9;
+
+      printf("%ld lines, %ld bytes in %.3f ms (%.1f MB/s)\n",
+             lines, (long)st.st_size, secs * 1000,
+             secs > 0 ? st.st_size / secs / 1e6 : 0.0);
+   }
+
+   return errnum;
+}
+
 const char *filename = "read_file_lines.test";
+int time_flag = 0;
+int map_flag = 0;
+int max_len = 0;
+int chunks = 0;
+int async_flag = 0;
+int spans_flag = 0;
+int decompress_flag = 0;
+#ifdef __linux__
+int follow_flag = 0;
+#endif
+int reverse_lines = 0;
 
 raAction actions[] = {
    {'h', "help", "Help screen", &ra_show_help_agent },
    {'b', "bufflen", "Length of line-reading buffer", &ra_int_agent, &RFL_bufflen },
-   {'f', "file", "File to read", &ra_string_agent, &filename }
+   {'f', "file", "File to read", &ra_string_agent, &filename },
+   {'t', "time", "Count lines and report scanning speed", &ra_flag_agent, &time_flag },
+   {'m', "map", "Use map_file_lines instead of read_file_lines", &ra_flag_agent, &map_flag },
+   {'l', "max_len", "Use read_file_long_lines with this line length limit",
+    &ra_int_agent, &max_len },
+   {'p', "parallel", "With -t, count lines in this many parallel chunks",
+    &ra_int_agent, &chunks },
+   {'a', "async", "Use read_file_lines_async to read ahead", &ra_flag_agent, &async_flag },
+   {'s', "spans", "Use read_file_line_spans to get batches of lines", &ra_flag_agent, &spans_flag },
+   {'z', "decompress", "Use read_file_lines_decompress for compressed files",
+    &ra_flag_agent, &decompress_flag },
+#ifdef __linux__
+   {'F', "follow", "Keep reading lines as they are added to the file",
+    &ra_flag_agent, &follow_flag },
+#endif
+   {'r', "reverse", "Print this many lines from the end of the file, last first",
+    &ra_int_agent, &reverse_lines }
 };
 
 int main(int argc, const char **argv)
@@ -200,9 +2289,31 @@ int main(int argc, const char **argv)
 
    if (ra_process_arguments())
    {
-      errnum = read_file_lines(filename, read_file_lines_user, NULL);
+      if (time_flag)
+         errnum = time_line_scan(filename, map_flag, chunks, async_flag, spans_flag);
+      else if (map_flag)
+         errnum = map_file_lines(filename, read_file_lines_user, NULL);
+      else if (async_flag)
+         errnum = read_file_lines_async(filename, read_file_lines_user, NULL);
+      else if (spans_flag)
+         errnum = read_file_line_spans(filename, read_file_lines_user_spans, NULL);
+      else if (decompress_flag)
+         errnum = read_file_lines_decompress(filename, read_file_lines_user, NULL);
+#ifdef __linux__
+      else if (follow_flag)
+         errnum = follow_file_lines(filename, read_file_lines_user, NULL);
+#endif
+      else if (reverse_lines > 0)
+         errnum = read_file_lines_reverse(filename, read_file_lines_tail, &reverse_lines);
+      else if (max_len > 0)
+         errnum = read_file_long_lines(filename, max_len,
+                                       read_file_lines_user,
+                                       read_file_lines_overflow,
+                                       &max_len);
+      else
+         errnum = read_file_lines(filename, read_file_lines_user, NULL);
       if (errnum)
-         printf("Failed to open \"%s\" (%s).\n", filename, strerror(errnum));
+         printf("Failed to read \"%s\" (%s).\n", filename, strerror(errnum));
    }
 
    return errnum;
@@ -215,6 +2326,6 @@ int main(int argc, const char **argv)
 /* compile-command: "b=read_file_lines; \*/
 /*  cc -Wall -Werror -ggdb        \*/
 /*  -std=c99 -pedantic            \*/
-/*  -lreadargs                    \*/
-/*  -D${b^^}_MAIN -o $b ${b}.c"   \*/
+/*  -D${b^^}_MAIN -o $b ${b}.c    \*/
+/*  -lreadargs -lpthread"         \*/
 /* End: */
@@ -1,6 +1,8 @@
 #ifndef READ_FILE_LINES_H
 #define READ_FILE_LINES_H
 
+#include <stddef.h>    // for size_t
+
 // Default value is 2048.  Adjust buffer length according to your needs
 extern unsigned RFL_bufflen;
 
@@ -10,8 +12,90 @@ typedef int rfl_bool;
 
 typedef rfl_bool (*line_user_f)(const char *start, const char *end, void *closure);
 
+// Called with the beginning of a line longer than the maximum length.
+// Return non-zero to skip the line and continue, 0 to stop reading.
+typedef rfl_bool (*line_overflow_f)(const char *start, const char *end, void *closure);
+
 int read_handle_lines(int fh, line_user_f user, void *closure);
 int read_file_lines(const char *filepath, line_user_f user, void *closure);
 
+// Returns the first '\r' or '\n' in [ptr, end), or *end* if none
+const char *find_line_end(const char *ptr, const char *end);
+
+// Grow a heap buffer as needed for lines shorter than *max_len* bytes
+int read_handle_long_lines(int fh,
+                           size_t max_len,
+                           line_user_f user,
+                           line_overflow_f overflow,
+                           void *closure);
+int read_file_long_lines(const char *filepath,
+                         size_t max_len,
+                         line_user_f user,
+                         line_overflow_f overflow,
+                         void *closure);
+
+// Deliver lines last to first, reading blocks back from the end
+// of a regular file, so the last lines of a large file come quickly
+int read_handle_lines_reverse(int fh, line_user_f user, void *closure);
+int read_file_lines_reverse(const char *filepath, line_user_f user, void *closure);
+
+// Batch delivery: all the complete lines of a buffer, in
+// arrays of up to RFL_SPAN_BATCH lines per call
+#ifndef RFL_SPAN_BATCH
+#define RFL_SPAN_BATCH 256
+#endif
+
+typedef struct rfl_span_s {
+   const char *start;
+   const char *end;
+} RFL_SPAN;
+
+typedef rfl_bool (*line_spans_f)(const RFL_SPAN *spans, int count, void *closure);
+
+int read_handle_line_spans(int fh, line_spans_f user, void *closure);
+int read_file_line_spans(const char *filepath, line_spans_f user, void *closure);
+
+// Read gzip (compile with -DRFL_GZIP -lz) or zstd (-DRFL_ZSTD -lzstd)
+// files, identified by their first bytes, or uncompressed files
+int read_handle_lines_decompress(int fh, line_user_f user, void *closure);
+int read_file_lines_decompress(const char *filepath, line_user_f user, void *closure);
+
+#ifdef __linux__
+// Linux only: deliver lines as they are appended to a file,
+// following log rotation, until *user* returns 0 or no change
+// occurs for RFL_follow_timeout milliseconds (-1 for no limit)
+extern int RFL_follow_timeout;
+int follow_file_lines(const char *filepath, line_user_f user, void *closure);
+#endif
+
+// Read-ahead alternatives that keep several large buffers in flight
+extern unsigned RFL_async_bufflen;   // default 1MB
+extern unsigned RFL_async_count;     // buffers, default 3
+
+int read_handle_lines_async(int fh, line_user_f user, void *closure);
+int read_file_lines_async(const char *filepath, line_user_f user, void *closure);
+
+// Zero-copy alternatives that map regular files into memory
+int map_handle_lines(int fh, line_user_f user, void *closure);
+int map_file_lines(const char *filepath, line_user_f user, void *closure);
+
+// Called in chunk order after parallel processing to combine results
+typedef void (*chunk_merge_f)(int chunk, void *chunk_closure, void *closure);
+
+// Process *chunks* line-aligned sections of a mapped file in parallel,
+// calling *user* with *chunk_closures[i]* for the lines of chunk *i*.
+int map_handle_lines_parallel(int fh,
+                              int chunks,
+                              line_user_f user,
+                              void **chunk_closures,
+                              chunk_merge_f merge,
+                              void *closure);
+int map_file_lines_parallel(const char *filepath,
+                            int chunks,
+                            line_user_f user,
+                            void **chunk_closures,
+                            chunk_merge_f merge,
+                            void *closure);
+
 
 #endif
@@ -1,6 +1,13 @@
 /** @file */
 
 #include <string.h>   // for memcpy
+#include <stdlib.h>   // for malloc, realloc, free
+#include <stdio.h>    // for rename, remove
+#include <errno.h>
+#include <fcntl.h>     // for open()
+#include <unistd.h>    // for write(), close()
+#include <sys/stat.h>  // for fstat()
+#include <sys/mman.h>  // for mmap()
 #include "sarray.h"
 
 /**
@@ -104,6 +111,414 @@ const char *sarray_element_by_index(sarray_handle *handle, unsigned index)
       return NULL;
 }
 
+/**
+ * @brief Size of the first chunk of the @ref sarray_build_once arena.
+ *
+ * Each chunk after the first is twice the size of the previous
+ * chunk, or large enough for a longer string.
+ */
+#ifndef SARRAY_CHUNK_SIZE
+#define SARRAY_CHUNK_SIZE 4096
+#endif
+
+/**
+ * @brief Block of arena memory to which @ref sarray_build_once
+ *        appends strings.
+ */
+typedef struct sarray_chunk {
+   struct sarray_chunk *next;  ///< next chunk, in the order the chunks were filled
+   size_t size;                ///< capacity of @p text
+   size_t used;                ///< characters used in @p text
+   char   text[];              ///< '\0'-terminated strings
+} sarray_chunk;
+
+/**
+ * @brief Collects strings for @ref sarray_build_once.
+ */
+typedef struct sarray_arena {
+   sarray_chunk *first;     ///< first chunk, the beginning of the text
+   sarray_chunk *last;      ///< chunk to which strings are appended
+   size_t       text_len;   ///< total length of the strings, including '\0'
+   size_t       *offsets;   ///< offset of each string in the compacted text
+   unsigned     count;      ///< number of strings in @p offsets
+   unsigned     capacity;   ///< number of elements allocated for @p offsets
+   int          failed;     ///< set if memory ran out
+} sarray_arena;
+
+/**
+ * @brief Called for each string by the walker function of
+ *        @ref sarray_build_once.
+ *
+ * Copies the string to the end of the last chunk, starting a new
+ * chunk if it doesn't fit, and records where the string will
+ * be in the compacted text.  Strings don't span chunks, so the
+ * used portions of the chunks, joined in order, are the text.
+ */
+static void sarray_arena_add_string(const char *start, int length, void *data)
+{
+   sarray_arena *arena = (sarray_arena*)data;
+   if (arena->failed)
+      return;
+
+   size_t needed = (size_t)length + 1;
+   sarray_chunk *chunk = arena->last;
+
+   if (!chunk || chunk->size - chunk->used < needed)
+   {
+      size_t size = chunk ? chunk->size * 2 : SARRAY_CHUNK_SIZE;
+      if (size < needed)
+         size = needed;
+
+      sarray_chunk *newchunk = (sarray_chunk*)malloc(sizeof(sarray_chunk) + size);
+      if (!newchunk)
+      {
+         arena->failed = 1;
+         return;
+      }
+
+      newchunk->next = NULL;
+      newchunk->size = size;
+      newchunk->used = 0;
+
+      if (chunk)
+         chunk->next = newchunk;
+      else
+         arena->first = newchunk;
+
+      arena->last = chunk = newchunk;
+   }
+
+   if (arena->count == arena->capacity)
+   {
+      unsigned capacity = arena->capacity ? arena->capacity * 2 : 256;
+      size_t *offsets = (size_t*)realloc(arena->offsets, capacity * sizeof(size_t));
+      if (!offsets)
+      {
+         arena->failed = 1;
+         return;
+      }
+
+      arena->offsets = offsets;
+      arena->capacity = capacity;
+   }
+
+   memcpy(chunk->text + chunk->used, start, length);
+   chunk->text[chunk->used + length] = '\0';
+   chunk->used += needed;
+
+   arena->offsets[arena->count++] = arena->text_len;
+   arena->text_len += needed;
+}
+
+/**
+ * @brief Build a sarray_handle with a single call to the walker function
+ *
+ * Unlike @ref sarray_measure and @ref sarray_build, which call
+ * @p func twice, this function calls @p func once, copying the
+ * strings into a chunked arena as they come.  The arena is then
+ * compacted into a single block of memory with the same layout
+ * that @ref sarray_build makes, an array of string pointers
+ * followed by the strings, except that the strings are in
+ * array order.  The walker function need not repeat its list,
+ * and an expensive source, like a file scan, is only read once.
+ *
+ * @param [out] handle   Handle to which the string array is installed
+ * @param [in]  string   String to transform
+ * @param [in]  func     String-walker function to extract substrings
+ * @return The memory block of the handle, which the caller must
+ *         free() when done with the handle, or NULL if memory
+ *         ran out, in which case the handle is empty.
+ */
+char *sarray_build_once(sarray_handle *handle, const char *string, walker_func func)
+{
+   sarray_arena arena = { 0 };
+
+   (*func)(string, sarray_arena_add_string, &arena);
+
+   char *buffer = NULL;
+   if (!arena.failed)
+   {
+      size_t array_len = arena.count * sizeof(char*);
+
+      // Allocate at least one byte, so an empty result isn't NULL
+      buffer = (char*)malloc(array_len + arena.text_len + 1);
+      if (buffer)
+      {
+         char *text = buffer + array_len;
+         char *ptr = text;
+         for (sarray_chunk *chunk = arena.first; chunk; chunk = chunk->next)
+         {
+            memcpy(ptr, chunk->text, chunk->used);
+            ptr += chunk->used;
+         }
+
+         const char **strings = (const char**)buffer;
+         for (unsigned index = 0; index < arena.count; ++index)
+            strings[index] = text + arena.offsets[index];
+      }
+   }
+
+   sarray_chunk *chunk = arena.first;
+   while (chunk)
+   {
+      sarray_chunk *next = chunk->next;
+      free(chunk);
+      chunk = next;
+   }
+   free(arena.offsets);
+
+   handle->strings = (const char**)buffer;
+   handle->count = buffer ? arena.count : 0;
+
+   return buffer;
+}
+
+/**
+ * @brief Copy the strings of a handle to a relocatable block of memory
+ *
+ * The block begins with a @ref sarray_packed_header, followed by an
+ * entry with the offset and length of each string, then the
+ * strings, in array order, so the block has no pointers and can be
+ * saved, mapped, or shared as it is.
+ *
+ * @param [in]  handle   Handle of the strings to pack
+ * @param [out] block    Set to the packed block, which the caller must free()
+ * @param [out] size     Set to the number of bytes in @p block
+ * @return 0 for success, ENOMEM if memory ran out, or EFBIG if the
+ *         block would be too large for 32-bit offsets.
+ */
+int sarray_pack(const sarray_handle *handle, char **block, size_t *size)
+{
+   size_t index_len = sizeof(sarray_packed_header)
+      + (size_t)handle->count * sizeof(sarray_packed_entry);
+   size_t text_len = 0;
+
+   for (unsigned index = 0; index < handle->count; ++index)
+      text_len += strlen(handle->strings[index]) + 1;
+
+   if (index_len + text_len > UINT32_MAX)
+      return EFBIG;
+
+   char *buffer = (char*)malloc(index_len + text_len);
+   if (!buffer)
+      return ENOMEM;
+
+   sarray_packed_header *header = (sarray_packed_header*)buffer;
+   header->magic = SARRAY_PACKED_MAGIC;
+   header->version = SARRAY_PACKED_VERSION;
+   header->count = handle->count;
+   header->text_len = (uint32_t)text_len;
+
+   sarray_packed_entry *entry = (sarray_packed_entry*)(header + 1);
+   char *ptr = buffer + index_len;
+
+   for (unsigned index = 0; index < handle->count; ++index, ++entry)
+   {
+      size_t length = strlen(handle->strings[index]);
+      memcpy(ptr, handle->strings[index], length + 1);
+
+      entry->offset = (uint32_t)(ptr - buffer);
+      entry->length = (uint32_t)length;
+
+      ptr += length + 1;
+   }
+
+   *block = buffer;
+   *size = index_len + text_len;
+
+   return 0;
+}
+
+/**
+ * @brief Pack the strings of a handle and write the block to a file
+ *
+ * The file, created or replaced at @p path, can be used with
+ * @ref sarray_packed_open.  The block is written under a temporary
+ * name, then renamed to @p path, so a failed write doesn't leave a
+ * partial file, and processes that have mapped the old file keep
+ * its contents rather than getting SIGBUS when it is truncated.
+ *
+ * @param handle   Handle of the strings to save
+ * @param path     Path of the file to write
+ * @return 0 for success, the errno value if it fails.
+ */
+int sarray_pack_file(const sarray_handle *handle, const char *path)
+{
+   char *block;
+   size_t size;
+   int errnum = sarray_pack(handle, &block, &size);
+   if (errnum)
+      return errnum;
+
+   size_t path_len = strlen(path);
+   char tmppath[path_len + 5];
+   memcpy(tmppath, path, path_len);
+   memcpy(tmppath + path_len, ".tmp", 5);
+
+   int fh = open(tmppath, O_WRONLY | O_CREAT | O_TRUNC, 0644);
+   if (fh == -1)
+      errnum = errno;
+   else
+   {
+      size_t total = 0;
+      while (total < size)
+      {
+         ssize_t bytes_written = write(fh, block + total, size - total);
+         if (bytes_written == -1)
+         {
+            if (errno == EINTR)
+               continue;
+            errnum = errno;
+            break;
+         }
+         total += (size_t)bytes_written;
+      }
+
+      if (close(fh) && !errnum)
+         errnum = errno;
+
+      if (!errnum && rename(tmppath, path))
+         errnum = errno;
+
+      if (errnum)
+         remove(tmppath);
+   }
+
+   free(block);
+
+   return errnum;
+}
+
+/**
+ * @brief Use a packed block in memory, checking only its header
+ *
+ * The strings are not read, so attaching takes the same time for
+ * any number of strings.  The block must remain valid, and at its
+ * original address, while @p packed is used.
+ *
+ * @param [out] packed   Set to access the block
+ * @param [in]  block    Packed block made by @ref sarray_pack,
+ *                       aligned for a uint32_t
+ * @param [in]  size     Number of bytes in @p block
+ * @return 0 for success, or EINVAL if the block is too small for
+ *         its header and entries, or the header doesn't match.
+ */
+int sarray_packed_attach(sarray_packed *packed, const void *block, size_t size)
+{
+   memset(packed, 0, sizeof(sarray_packed));
+
+   const sarray_packed_header *header = (const sarray_packed_header*)block;
+   if (size < sizeof(sarray_packed_header)
+       || header->magic != SARRAY_PACKED_MAGIC
+       || header->version != SARRAY_PACKED_VERSION
+       || (size - sizeof(sarray_packed_header)) / sizeof(sarray_packed_entry) < header->count)
+      return EINVAL;
+
+   packed->header = header;
+   packed->entries = (const sarray_packed_entry*)(header + 1);
+   packed->size = size;
+
+   return 0;
+}
+
+/**
+ * @brief Map a file written by @ref sarray_pack_file
+ *
+ * The file is mapped read-only and shared, so processes that open
+ * the same file share its pages, and the strings are read from
+ * disk as they are used rather than when the file is opened.
+ * Release the mapping with @ref sarray_packed_close.
+ *
+ * @param [out] packed   Set to access the mapped block
+ * @param [in]  path     Path of the file to map
+ * @return 0 for success, the errno value if it fails, or EINVAL if
+ *         the file isn't a packed sarray.
+ */
+int sarray_packed_open(sarray_packed *packed, const char *path)
+{
+   memset(packed, 0, sizeof(sarray_packed));
+
+   int fh = open(path, O_RDONLY);
+   if (fh == -1)
+      return errno;
+
+   int errnum = 0;
+   struct stat st;
+   if (fstat(fh, &st))
+      errnum = errno;
+   else if (st.st_size < (off_t)sizeof(sarray_packed_header))
+      errnum = EINVAL;
+   else
+   {
+      size_t size = (size_t)st.st_size;
+      void *map = mmap(NULL, size, PROT_READ, MAP_SHARED, fh, 0);
+      if (map == MAP_FAILED)
+         errnum = errno;
+      else
+      {
+         errnum = sarray_packed_attach(packed, map, size);
+         if (errnum)
+            munmap(map, size);
+         else
+            packed->mapped = 1;
+      }
+   }
+
+   // The mapping remains after the file is closed
+   close(fh);
+
+   return errnum;
+}
+
+/**
+ * @brief Release the mapping of a block opened with @ref sarray_packed_open
+ *
+ * A block attached with @ref sarray_packed_attach is left to the
+ * caller to free.
+ */
+void sarray_packed_close(sarray_packed *packed)
+{
+   if (packed->mapped)
+      munmap((void*)packed->header, packed->size);
+
+   memset(packed, 0, sizeof(sarray_packed));
+}
+
+/**
+ * @brief Safely return a string from a packed block
+ *
+ * Like @ref sarray_element_by_index, returns NULL if the index is
+ * out of range.  Since the block may come from a file, it also
+ * returns NULL if the entry places the string or its '\0' outside
+ * of the block.
+ *
+ * @param [in]  packed   packed block to search
+ * @param [in]  index    0-based index into the array
+ * @param [out] length   if not NULL, set to the length of the string
+ * @return Requested string if in range, NULL if not
+ */
+const char *sarray_packed_element(const sarray_packed *packed,
+                                  unsigned index,
+                                  unsigned *length)
+{
+   if (!packed->header || index >= packed->header->count)
+      return NULL;
+
+   const sarray_packed_entry *entry = &packed->entries[index];
+   if (entry->offset >= packed->size
+       || packed->size - entry->offset <= entry->length)
+      return NULL;
+
+   const char *string = (const char*)packed->header + entry->offset;
+   if (string[entry->length] != '\0')
+      return NULL;
+
+   if (length)
+      *length = entry->length;
+
+   return string;
+}
+
 #ifdef SARRAY_MAIN
 
 #include <stdio.h>
@@ -195,14 +610,74 @@ void run_demo(const char *str)
       printf("No substrings found in '%s'\n", str);
 }
 
-int main(int argc, const char **argv)
+/**
+ * @brief Demonstrates building an array with @ref sarray_build_once
+ *
+ * The same result as @ref run_demo, with one call to the
+ * string-walker function and no measuring step.
+ */
+void run_demo_once(const char *str)
 {
-   if (argc < 2)
+   sarray_handle sh = { 0 };
+
+   char *buff = sarray_build_once(&sh, str, custom_string_walker);
+   if (buff)
    {
-      printf("Please provide one or more strings to process.\n");
-      return 1;
+      if (sh.count)
+         display_array(&sh);
+      else
+         printf("No substrings found in '%s'\n", str);
+
+      free(buff);
+   }
+}
+
+/**
+ * @brief Builds an array from @p str and saves it as a packed file
+ */
+void save_packed(const char *path, const char *str)
+{
+   sarray_handle sh = { 0 };
+
+   char *buff = sarray_build_once(&sh, str, custom_string_walker);
+   if (buff)
+   {
+      int errnum = sarray_pack_file(&sh, path);
+      if (errnum)
+         printf("Failed to save '%s': %s\n", path, strerror(errnum));
+      else
+         printf("Saved %u strings to '%s'\n", sh.count, path);
+
+      free(buff);
+   }
+}
+
+/**
+ * @brief Maps a packed file and displays its strings
+ */
+void show_packed(const char *path)
+{
+   sarray_packed packed;
+
+   int errnum = sarray_packed_open(&packed, path);
+   if (errnum)
+   {
+      printf("Failed to open '%s': %s\n", path, strerror(errnum));
+      return;
    }
 
+   const char *str;
+   unsigned length;
+   for (unsigned index = 0;
+        (str = sarray_packed_element(&packed, index, &length));
+        ++index)
+      printf("\"%.*s\"\n", (int)length, str);
+
+   sarray_packed_close(&packed);
+}
+
+int main(int argc, const char **argv)
+{
    // Use pointers to track arg processing progress
    const char **arg = argv;
    const char **end = arg + argc;
@@ -210,9 +685,39 @@ int main(int argc, const char **argv)
    // skip the command name
    ++arg;
 
+   // Option -w saves the words of a string to a packed file,
+   // and option -r displays the words of a packed file
+   if (arg + 1 < end && strcmp(*arg, "-r") == 0)
+   {
+      show_packed(arg[1]);
+      return 0;
+   }
+   else if (arg + 2 < end && strcmp(*arg, "-w") == 0)
+   {
+      save_packed(arg[1], arg[2]);
+      return 0;
+   }
+
+   // Option -o builds each array in one pass
+   void (*demo)(const char*) = run_demo;
+   if (arg < end && strcmp(*arg, "-o") == 0)
+   {
+      demo = run_demo_once;
+      ++arg;
+   }
+
+   if (arg == end)
+   {
+      printf("Please provide one or more strings to process.\n");
+      printf("Precede the strings with -o to build in one pass,\n"
+             "or use -w FILE STRING to save a packed file,\n"
+             "or use -r FILE to display a packed file.\n");
+      return 1;
+   }
+
    while (arg < end)
    {
-      run_demo(*arg);
+      (*demo)(*arg);
       ++arg;
    }
 
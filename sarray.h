@@ -3,6 +3,9 @@
 #ifndef SARRAY_H
 #define SARRAY_H
 
+#include <stddef.h>   // for size_t
+#include <stdint.h>   // for uint32_t
+
 /**
  * @defgroup SARRAY SARRAY: a mini library for string arrays
  * @{
@@ -82,6 +85,67 @@ void sarray_build(sarray_handle *handle,
 
 const char *sarray_element_by_index(sarray_handle *handle, unsigned index);
 
+char *sarray_build_once(sarray_handle *handle, const char *string, walker_func func);
+
+/**
+ * @brief Identifies a packed sarray block, "SARY" in a little-endian file
+ */
+#define SARRAY_PACKED_MAGIC 0x59524153u
+
+/**
+ * @brief Layout version of a packed sarray block
+ */
+#define SARRAY_PACKED_VERSION 1u
+
+/**
+ * @brief Beginning of a packed sarray block
+ *
+ * A packed block holds no pointers, so it can be written to a file
+ * and used where it's loaded or mapped.  The header is followed by
+ * @p count @ref sarray_packed_entry elements, then by @p text_len
+ * bytes of '\0'-terminated strings.  Numbers are in the byte order
+ * of the machine that packed the block, and a block from a machine
+ * of the other byte order fails the @p magic test.
+ */
+typedef struct sarray_packed_header {
+   uint32_t magic;      ///< @ref SARRAY_PACKED_MAGIC
+   uint32_t version;    ///< @ref SARRAY_PACKED_VERSION
+   uint32_t count;      ///< number of strings
+   uint32_t text_len;   ///< bytes of strings after the entries, including '\0's
+} sarray_packed_header;
+
+/**
+ * @brief Location of one string in a packed sarray block
+ */
+typedef struct sarray_packed_entry {
+   uint32_t offset;     ///< offset of the string from the beginning of the block
+   uint32_t length;     ///< length of the string, not including its '\0'
+} sarray_packed_entry;
+
+/**
+ * @brief Access to a packed sarray block, in memory or mapped from a file
+ *
+ * Initialize with @ref sarray_packed_open or @ref sarray_packed_attach,
+ * then get strings with @ref sarray_packed_element.
+ */
+typedef struct sarray_packed {
+   const sarray_packed_header *header;  ///< beginning of the block
+   const sarray_packed_entry  *entries; ///< array of @p header->count entries
+   size_t                     size;     ///< bytes in the block
+   int                        mapped;   ///< set if the block is a file mapping
+} sarray_packed;
+
+int sarray_pack(const sarray_handle *handle, char **block, size_t *size);
+int sarray_pack_file(const sarray_handle *handle, const char *path);
+
+int sarray_packed_attach(sarray_packed *packed, const void *block, size_t size);
+int sarray_packed_open(sarray_packed *packed, const char *path);
+void sarray_packed_close(sarray_packed *packed);
+
+const char *sarray_packed_element(const sarray_packed *packed,
+                                  unsigned index,
+                                  unsigned *length);
+
 
 
 
@@ -145,6 +209,28 @@ const char *sarray_element_by_index(sarray_handle *handle, unsigned index);
  * A usage example can be found in @ref SARRAY_C_SOURCE in function
  * _run_demo_.
  *
+ * @subsection SARRAY_BUILDING_ONCE Building with one pass
+ *
+ * If the parsing function is expensive, or can't repeat its list,
+ * call _sarray_build_once_ instead.  It calls the parsing function
+ * once, collecting the strings in a growing arena, then packs them
+ * into a block of memory with the same layout.  The function
+ * returns the block, which must be freed when the handle is no
+ * longer needed.  See function _run_demo_once_ in @ref SARRAY_C_SOURCE.
+ *
+ * @subsection SARRAY_PACKED Saving and mapping a packed array
+ *
+ * The string pointers of a handle are only good in the process that
+ * built it.  _sarray_pack_ copies a handle to a block that locates
+ * the strings with 32-bit offsets and lengths from the beginning of
+ * the block, after a header with a magic number, a version, and the
+ * count.  _sarray_pack_file_ writes the block to a file, and
+ * _sarray_packed_open_ maps the file read-only and only checks the
+ * header, so a large array is ready without reading or parsing the
+ * strings.  _sarray_packed_element_ checks that an entry is inside
+ * the block before returning its string.  See functions
+ * _save_packed_ and _show_packed_ in @ref SARRAY_C_SOURCE.
+ *
  * @subsection SARRAY_USAGE Safely using the strings array
  *
  * The handle does not enforce safe usage, but only provides the